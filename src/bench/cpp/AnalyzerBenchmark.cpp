@@ -0,0 +1,111 @@
+/**
+ * Measures the NPE analysis on real class files without a JVM: each file is mapped and parsed in place,
+ * then every instruction that can throw an NPE is described, as for the blame table of each method.
+ * Usage: analyzer-benchmark [-n iterations] file.class...
+ */
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "analyzer.h"
+#include "bytecode/ClassFile.h"
+#include "bytecode/MappedFile.h"
+#include "bytecode/Method.h"
+#include "util.h"
+
+struct ClassResult {
+  size_t methods = 0;
+  size_t sites = 0;
+  size_t failures = 0;
+};
+
+static ClassResult describeClass(const ClassFile &classFile) {
+  const ConstPool &constPool = classFile.getConstPool();
+  std::string className = toJavaClassName(constPool.getClassName(classFile.getThisClass()));
+
+  ClassResult result;
+  for (const MemberInfo &member : classFile.getMethods()) {
+    const AttributeInfo *codeAttribute = classFile.findAttribute(member.attributes, "Code");
+    if (codeAttribute == nullptr) { continue; }
+
+    result.methods++;
+    try {
+      CodeInfo info = classFile.readCode(*codeAttribute);
+      const AttributeInfo *variables = classFile.findAttribute(info.attributes, "LocalVariableTable");
+      LocalVariableTable localVariables =
+          variables == nullptr ? LocalVariableTable() : classFile.readLocalVariableTable(*variables);
+      CodeAttribute code(classFile.getBytes().subview(info.codeOffset, info.codeLength), localVariables);
+      Method method(className, constPool.getUtf8(member.nameIndex), constPool.getUtf8(member.descriptorIndex),
+                    member.accessFlags);
+      result.sites += describeNPEInstructions(method, constPool, code, localVariables, &info.handlerPcs).size();
+    } catch (const std::exception &) {
+      // Code the analysis rejects is counted instead of aborting the run
+      result.failures++;
+    }
+  }
+  return result;
+}
+
+int main(int argc, char **argv) {
+  size_t iterations = 10;
+  std::vector<std::string> paths;
+  for (int i = 1; i < argc; i++) {
+    if (std::strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+      iterations = std::strtoul(argv[++i], nullptr, 10);
+    } else {
+      paths.emplace_back(argv[i]);
+    }
+  }
+  if (paths.empty() || iterations == 0) {
+    std::fprintf(stderr, "Usage: analyzer-benchmark [-n iterations] file.class...\n");
+    return 1;
+  }
+  spdlog::set_level(spdlog::level::warn);
+
+  std::vector<std::unique_ptr<MappedFile>> files;
+  size_t totalBytes = 0;
+  try {
+    for (const std::string &path : paths) {
+      files.push_back(std::make_unique<MappedFile>(path));
+      totalBytes += files.back()->getBytes().size();
+    }
+  } catch (const std::exception &e) {
+    std::fprintf(stderr, "%s\n", e.what());
+    return 1;
+  }
+
+  ClassResult total;
+  double parseMicros = 0;
+  double describeMicros = 0;
+  for (size_t iteration = 0; iteration < iterations; iteration++) {
+    for (const std::unique_ptr<MappedFile> &file : files) {
+      auto start = std::chrono::steady_clock::now();
+      ClassFile classFile(file->getBytes());
+      auto parsed = std::chrono::steady_clock::now();
+      ClassResult result = describeClass(classFile);
+      auto described = std::chrono::steady_clock::now();
+
+      parseMicros += std::chrono::duration<double, std::micro>(parsed - start).count();
+      describeMicros += std::chrono::duration<double, std::micro>(described - parsed).count();
+      if (iteration == 0) {
+        total.methods += result.methods;
+        total.sites += result.sites;
+        total.failures += result.failures;
+      }
+    }
+  }
+
+  std::printf("%zu classes, %zu bytes, %zu methods, %zu NPE sites, %zu methods failed\n", files.size(), totalBytes,
+              total.methods, total.sites, total.failures);
+  std::printf("%-24s %10.3f us per class\n", "parse in place", parseMicros / iterations / files.size());
+  std::printf("%-24s %10.3f us per class\n", "describe all sites", describeMicros / iterations / files.size());
+  if (total.sites > 0) {
+    std::printf("%-24s %10.3f us per site\n", "describe", describeMicros / iterations / total.sites);
+  }
+  return 0;
+}
@@ -0,0 +1,77 @@
+/**
+ * Measures decoding the instruction boundaries of a generated method close to the 64KB code limit,
+ * fully and lazily up to an NPE location in the middle, and looking up the index of that location.
+ * Usage: code-benchmark [iterations]
+ */
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "bytecode/CodeAttribute.h"
+#include "bytecode/Constants.h"
+#include "util.h"
+
+/**
+ * Repeated field accesses and calls, as in generated parsers, with a tableswitch every 256 blocks
+ */
+static std::vector<uint8_t> generateCode(size_t maxLength) {
+  std::vector<uint8_t> code;
+  for (size_t block = 0; code.size() + 64 < maxLength; block++) {
+    ByteVectorUtil::writeuint8(code, OpCodes::ALOAD_1);
+    ByteVectorUtil::writeuint8(code, OpCodes::GETFIELD);
+    ByteVectorUtil::writeuint16(code, 2);
+    ByteVectorUtil::writeuint8(code, OpCodes::ICONST_1);
+    ByteVectorUtil::writeuint8(code, OpCodes::INVOKEVIRTUAL);
+    ByteVectorUtil::writeuint16(code, 3);
+    ByteVectorUtil::writeuint8(code, OpCodes::POP);
+
+    if (block % 256 == 0) {
+      size_t offset = code.size();
+      ByteVectorUtil::writeuint8(code, OpCodes::ICONST_0);
+      ByteVectorUtil::writeuint8(code, OpCodes::TABLESWITCH);
+      code.insert(code.end(), 3 - (offset + 1) % 4, 0);
+      // default, low 0, high 1, both cases continue after the switch
+      int32_t next = static_cast<int32_t>(4 + 4 + 4 + 2 * 4 + 1 + (3 - (offset + 1) % 4));
+      for (int32_t value : {next, 0, 1, next, next}) {
+        ByteVectorUtil::writeuint32(code, static_cast<uint32_t>(value));
+      }
+    }
+  }
+  ByteVectorUtil::writeuint8(code, OpCodes::RETURN);
+  return code;
+}
+
+template<typename Fn>
+static double measure(size_t iterations, Fn fn) {
+  volatile size_t sink = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < iterations; i++) {
+    sink = sink + fn();
+  }
+  std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - start;
+  return elapsed.count() / iterations;
+}
+
+int main(int argc, char **argv) {
+  size_t iterations = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 200;
+
+  std::vector<uint8_t> bytes = generateCode(65535);
+  CodeAttribute decoded(bytes);
+  const std::vector<uint16_t> &instructions = decoded.getInstructions();
+  size_t location = instructions[instructions.size() / 2];
+
+  std::printf("Method with %zu instructions, %zu bytes\n", instructions.size(), bytes.size());
+  std::printf("%-24s %10.3f us\n", "decode all", measure(iterations, [&]() {
+    CodeAttribute code(bytes);
+    return code.getInstructions().size();
+  }));
+  std::printf("%-24s %10.3f us\n", "decode to location", measure(iterations, [&]() {
+    CodeAttribute code(bytes);
+    return code.getInstructionIndex(location);
+  }));
+  std::printf("%-24s %10.3f us\n", "getInstructionIndex", measure(iterations * 1000, [&]() {
+    return decoded.getInstructionIndex(location);
+  }));
+  return 0;
+}
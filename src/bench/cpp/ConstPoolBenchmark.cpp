@@ -0,0 +1,79 @@
+/**
+ * Measures indexing a large constant pool and resolving the Fieldref needed to describe a single
+ * field access, as done when handling an NPE, via the pretty-printer and the string_view accessors.
+ * Usage: constpool-benchmark [entries] [iterations]
+ */
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "bytecode/ConstPool.h"
+#include "bytecode/Constants.h"
+#include "util.h"
+
+static void appendUtf8(std::vector<uint8_t> &bytes, const std::string &str) {
+  ByteVectorUtil::writeuint8(bytes, CpInfo::Utf8);
+  ByteVectorUtil::writeutf8(bytes, str);
+}
+
+/**
+ * Pool of a generated class: per field a name, a descriptor, a NameAndType and a Fieldref to it
+ * @return pool bytes, the index of the first Fieldref is 5
+ */
+static std::vector<uint8_t> generateConstPool(size_t fieldCount) {
+  std::vector<uint8_t> bytes;
+  appendUtf8(bytes, "com/example/GeneratedClass");
+  ByteVectorUtil::writeuint8(bytes, CpInfo::Class);
+  ByteVectorUtil::writeuint16(bytes, 1);
+
+  for (size_t i = 0; i < fieldCount; i++) {
+    uint16_t base = static_cast<uint16_t>(3 + 4 * i);
+    appendUtf8(bytes, "generatedField" + std::to_string(i));
+    appendUtf8(bytes, "Ljava/lang/String;");
+    ByteVectorUtil::writeuint8(bytes, CpInfo::NameAndType);
+    ByteVectorUtil::writeuint16(bytes, base);
+    ByteVectorUtil::writeuint16(bytes, base + 1);
+    ByteVectorUtil::writeuint8(bytes, CpInfo::Fieldref);
+    ByteVectorUtil::writeuint16(bytes, 2);
+    ByteVectorUtil::writeuint16(bytes, base + 2);
+  }
+  return bytes;
+}
+
+static size_t indexPool(const std::vector<uint8_t> &bytes) {
+  ConstPool constPool(bytes);
+  return constPool.size();
+}
+
+template<typename Fn>
+static double measure(size_t iterations, Fn fn) {
+  volatile size_t sink = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < iterations; i++) {
+    sink = sink + fn();
+  }
+  std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - start;
+  return elapsed.count() / iterations;
+}
+
+int main(int argc, char **argv) {
+  size_t entries = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 20000;
+  size_t iterations = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 200;
+
+  std::vector<uint8_t> bytes = generateConstPool(entries / 4);
+  ConstPool cached(bytes);
+  size_t fieldRefIndex = cached.size() - 1;
+
+  std::printf("Constant pool with %zu entries, %zu bytes\n", cached.size(), bytes.size());
+  std::printf("%-24s %10.3f us\n", "index pool", measure(iterations, [&]() { return indexPool(bytes); }));
+  std::printf("%-24s %10.3f us\n", "entryToString(Fieldref)", measure(iterations * 1000, [&]() {
+    return cached.entryToString(fieldRefIndex, false).size();
+  }));
+  std::printf("%-24s %10.3f us\n", "getMemberRef(Fieldref)", measure(iterations * 1000, [&]() {
+    MemberRef ref = cached.getMemberRef(fieldRefIndex);
+    return ref.className.size() + ref.name.size() + ref.descriptor.size();
+  }));
+  return 0;
+}
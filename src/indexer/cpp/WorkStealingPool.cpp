@@ -0,0 +1,94 @@
+#include "WorkStealingPool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace {
+
+// Own cache line per range, owners and thieves of different ranges don't contend
+struct alignas(64) TaskRange {
+  std::mutex mutex;
+  size_t begin = 0;
+  size_t end = 0;
+};
+
+}
+
+WorkStealingPool::WorkStealingPool(size_t threads)
+    : threadCount(threads > 0 ? threads : std::max(1u, std::thread::hardware_concurrency())) {}
+
+void WorkStealingPool::run(size_t taskCount, const std::function<void(size_t, size_t)> &task) {
+  size_t workers = std::max<size_t>(1, std::min(threadCount, taskCount));
+  std::unique_ptr<TaskRange[]> ranges(new TaskRange[workers]);
+  for (size_t i = 0; i < workers; i++) {
+    ranges[i].begin = taskCount * i / workers;
+    ranges[i].end = taskCount * (i + 1) / workers;
+  }
+
+  std::atomic<bool> failed{false};
+  std::exception_ptr failure;
+  std::mutex failureMutex;
+
+  auto takeOwn = [&](size_t worker, size_t &next) {
+    std::lock_guard<std::mutex> lock(ranges[worker].mutex);
+    if (ranges[worker].begin == ranges[worker].end) { return false; }
+    next = ranges[worker].begin++;
+    return true;
+  };
+
+  // Only one lock is held at a time, the stolen tasks are invisible to other thieves until moved to the own range
+  auto steal = [&](size_t worker) {
+    for (size_t i = 1; i < workers; i++) {
+      TaskRange &victim = ranges[(worker + i) % workers];
+      size_t begin;
+      size_t end;
+      {
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (victim.begin == victim.end) { continue; }
+        end = victim.end;
+        begin = victim.begin + (victim.end - victim.begin) / 2;
+        victim.end = begin;
+      }
+      std::lock_guard<std::mutex> lock(ranges[worker].mutex);
+      ranges[worker].begin = begin;
+      ranges[worker].end = end;
+      return true;
+    }
+    return false;
+  };
+
+  // Tasks are never added, once every range was seen empty there is nothing left to steal
+  auto work = [&](size_t worker) {
+    size_t next;
+    while (!failed.load(std::memory_order_relaxed)) {
+      if (!takeOwn(worker, next)) {
+        if (!steal(worker)) { return; }
+        continue;
+      }
+      try {
+        task(next, worker);
+      } catch (...) {
+        std::lock_guard<std::mutex> lock(failureMutex);
+        if (!failure) { failure = std::current_exception(); }
+        failed = true;
+      }
+    }
+  };
+
+  std::vector<std::thread> threads;
+  threads.reserve(workers - 1);
+  for (size_t worker = 1; worker < workers; worker++) {
+    threads.emplace_back(work, worker);
+  }
+  work(0);
+  for (std::thread &thread : threads) {
+    thread.join();
+  }
+
+  if (failure) { std::rethrow_exception(failure); }
+}
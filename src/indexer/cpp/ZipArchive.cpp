@@ -0,0 +1,161 @@
+#include "ZipArchive.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <fmt/fmt.h>
+
+#ifdef NPEBLAME_ZLIB
+#include <zlib.h>
+#endif
+
+using fmt::literals::operator""_format;
+
+static const uint32_t LOCAL_HEADER = 0x04034b50;
+static const uint32_t CENTRAL_HEADER = 0x02014b50;
+static const uint32_t END_OF_CENTRAL_DIRECTORY = 0x06054b50;
+static const uint32_t ZIP64_END_LOCATOR = 0x07064b50;
+static const uint32_t ZIP64_END_OF_CENTRAL_DIRECTORY = 0x06064b50;
+static const uint16_t ZIP64_EXTRA = 0x0001;
+static const uint16_t FLAG_ENCRYPTED = 0x0001;
+
+// Zip is little endian, unlike class files
+static uint16_t read16(ByteView bytes, size_t pos) {
+  if (pos + 2 > bytes.size()) { throw std::runtime_error("Zip structure at {} exceeds archive"_format(pos)); }
+  return static_cast<uint16_t>(bytes[pos] | bytes[pos + 1] << 8);
+}
+
+static uint32_t read32(ByteView bytes, size_t pos) {
+  return read16(bytes, pos) | static_cast<uint32_t>(read16(bytes, pos + 2)) << 16;
+}
+
+static uint64_t read64(ByteView bytes, size_t pos) {
+  return read32(bytes, pos) | static_cast<uint64_t>(read32(bytes, pos + 4)) << 32;
+}
+
+ZipArchive::ZipArchive(ByteView zipBytes) : bytes(zipBytes) {
+  size_t end = findEndOfCentralDirectory();
+  uint64_t entryCount = read16(bytes, end + 10);
+  uint64_t directorySize = read32(bytes, end + 12);
+  uint64_t directoryOffset = read32(bytes, end + 16);
+  size_t directoryEnd = end;
+
+  if (end >= 20 && read32(bytes, end - 20) == ZIP64_END_LOCATOR) {
+    uint64_t zip64End = read64(bytes, end - 20 + 8);
+    // The locator offset is relative to the archive start, which is unknown yet, search back from the locator
+    size_t pos = end - 20 - 56;
+    if (end < 20 + 56 || read32(bytes, pos) != ZIP64_END_OF_CENTRAL_DIRECTORY) {
+      if (zip64End + 56 > bytes.size() || read32(bytes, zip64End) != ZIP64_END_OF_CENTRAL_DIRECTORY) {
+        throw std::runtime_error("Zip64 end of central directory not found");
+      }
+      pos = zip64End;
+    }
+    entryCount = read64(bytes, pos + 32);
+    directorySize = read64(bytes, pos + 40);
+    directoryOffset = read64(bytes, pos + 48);
+    directoryEnd = pos;
+  }
+
+  if (directorySize > directoryEnd) { throw std::runtime_error("Zip central directory exceeds archive"); }
+  size_t directoryStart = directoryEnd - directorySize;
+  if (directoryStart < directoryOffset) { throw std::runtime_error("Zip central directory offset is invalid"); }
+  base = directoryStart - directoryOffset;
+
+  // Every central directory header takes at least 46 bytes
+  entries.reserve(std::min<uint64_t>(entryCount, directorySize / 46));
+  size_t pos = directoryStart;
+  for (uint64_t i = 0; i < entryCount; i++) {
+    if (read32(bytes, pos) != CENTRAL_HEADER) {
+      throw std::runtime_error("Zip central directory entry {} is corrupt"_format(i));
+    }
+
+    ZipEntry entry{};
+    entry.flags = read16(bytes, pos + 8);
+    entry.method = read16(bytes, pos + 10);
+    entry.compressedSize = read32(bytes, pos + 20);
+    entry.uncompressedSize = read32(bytes, pos + 24);
+    uint16_t nameLength = read16(bytes, pos + 28);
+    uint16_t extraLength = read16(bytes, pos + 30);
+    uint16_t commentLength = read16(bytes, pos + 32);
+    entry.localHeaderOffset = read32(bytes, pos + 42);
+
+    ByteView name = bytes.subview(pos + 46, nameLength);
+    entry.name = std::string_view(reinterpret_cast<const char *>(name.data()), name.size());
+
+    // Zip64 sizes and offset follow in this order, each only if the 32 bit field is saturated
+    size_t extra = pos + 46 + nameLength;
+    size_t extraEnd = extra + extraLength;
+    while (extra + 4 <= extraEnd) {
+      uint16_t id = read16(bytes, extra);
+      uint16_t size = read16(bytes, extra + 2);
+      if (id == ZIP64_EXTRA) {
+        size_t field = extra + 4;
+        if (entry.uncompressedSize == UINT32_MAX) { entry.uncompressedSize = read64(bytes, field); field += 8; }
+        if (entry.compressedSize == UINT32_MAX) { entry.compressedSize = read64(bytes, field); field += 8; }
+        if (entry.localHeaderOffset == UINT32_MAX) { entry.localHeaderOffset = read64(bytes, field); }
+      }
+      extra += 4 + size;
+    }
+
+    entries.push_back(entry);
+    pos = extraEnd + commentLength;
+  }
+}
+
+size_t ZipArchive::findEndOfCentralDirectory() const {
+  // Fixed 22 bytes followed by a comment of at most 65535 bytes
+  if (bytes.size() < 22) { throw std::runtime_error("Not a zip archive"); }
+  size_t limit = bytes.size() > 22 + 65535 ? bytes.size() - 22 - 65535 : 0;
+  for (size_t pos = bytes.size() - 22;; pos--) {
+    if (read32(bytes, pos) == END_OF_CENTRAL_DIRECTORY && pos + 22 + read16(bytes, pos + 20) == bytes.size()) {
+      return pos;
+    }
+    if (pos == limit) { break; }
+  }
+  throw std::runtime_error("Not a zip archive");
+}
+
+ByteView ZipArchive::read(const ZipEntry &entry, std::vector<uint8_t> &buffer) const {
+  if (entry.flags & FLAG_ENCRYPTED) {
+    throw std::runtime_error("{} is encrypted"_format(entry.name));
+  }
+
+  size_t header = base + entry.localHeaderOffset;
+  if (read32(bytes, header) != LOCAL_HEADER) {
+    throw std::runtime_error("Local header of {} is corrupt"_format(entry.name));
+  }
+  // Sizes in the local header may be zero if they follow the data, the central directory has them
+  size_t dataOffset = header + 30 + read16(bytes, header + 26) + read16(bytes, header + 28);
+  ByteView data = bytes.subview(dataOffset, entry.compressedSize);
+
+  if (entry.method == STORED) { return data; }
+  if (entry.method != DEFLATED) {
+    throw std::runtime_error("{} uses unsupported compression method {}"_format(entry.name, entry.method));
+  }
+
+#ifdef NPEBLAME_ZLIB
+  if (entry.uncompressedSize > UINT32_MAX) {
+    throw std::runtime_error("{} is too large to inflate"_format(entry.name));
+  }
+  buffer.resize(entry.uncompressedSize);
+
+  z_stream stream{};
+  // Raw deflate without zlib header
+  if (inflateInit2(&stream, -MAX_WBITS) != Z_OK) {
+    throw std::runtime_error("Failed to initialize inflate for {}"_format(entry.name));
+  }
+  stream.next_in = const_cast<Bytef *>(data.data());
+  stream.avail_in = static_cast<uInt>(std::min<size_t>(data.size(), UINT32_MAX));
+  stream.next_out = buffer.data();
+  stream.avail_out = static_cast<uInt>(buffer.size());
+  int result = inflate(&stream, Z_FINISH);
+  size_t inflated = stream.total_out;
+  inflateEnd(&stream);
+
+  if (result != Z_STREAM_END || inflated != buffer.size()) {
+    throw std::runtime_error("Failed to inflate {}: zlib error {}"_format(entry.name, result));
+  }
+  return ByteView(buffer);
+#else
+  throw std::runtime_error("{} is compressed and the indexer was built without zlib"_format(entry.name));
+#endif
+}
@@ -0,0 +1,247 @@
+/**
+ * Builds the NPE index loaded with the agent's index option: every method of the given jars, class directories and
+ * class files is analyzed once, offline and in parallel, and the description of each instruction that can throw an
+ * NPE is written to a compact index the agent maps instead of analyzing methods at run time.
+ * Usage: npeblame-indexer [-j threads] -o file.idx <jar|directory|class>...
+ */
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <filesystem>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "WorkStealingPool.h"
+#include "ZipArchive.h"
+#include "analyzer.h"
+#include "bytecode/ClassFile.h"
+#include "bytecode/MappedFile.h"
+#include "bytecode/Method.h"
+#include "cache/BlameIndex.h"
+#include "util.h"
+
+static auto logger = getLogger("Indexer");
+
+/**
+ * Class file in an archive or, to not keep 100k files mapped at once, a path mapped when the class is indexed
+ */
+struct ClassSource {
+  const ZipArchive *archive;
+  const ZipEntry *entry;
+  std::string path;
+};
+
+struct IndexedMethod {
+  size_t task;
+  std::string key;
+  uint64_t codeHash;
+  std::vector<std::pair<size_t, std::string>> sites;
+};
+
+struct WorkerResult {
+  std::vector<uint8_t> buffer;
+  std::vector<IndexedMethod> methods;
+  size_t classes = 0;
+  size_t failedClasses = 0;
+  size_t failedMethods = 0;
+};
+
+class Inputs {
+  std::vector<std::unique_ptr<MappedFile>> files;
+  // Inflated jars nested in other jars, e.g. in Spring Boot or WAR archives
+  std::vector<std::unique_ptr<std::vector<uint8_t>>> nestedJars;
+  std::vector<std::unique_ptr<ZipArchive>> archives;
+
+  static bool endsWith(std::string_view string, std::string_view suffix) {
+    return string.size() >= suffix.size() && string.substr(string.size() - suffix.size()) == suffix;
+  }
+
+  static bool isIndexed(std::string_view entryName) {
+    // Multi-release overrides would duplicate the keys of the base classes
+    return endsWith(entryName, ".class") && !endsWith(entryName, "module-info.class") &&
+           entryName.rfind("META-INF/versions/", 0) != 0;
+  }
+
+  void addArchive(ByteView bytes, const std::string &origin) {
+    archives.push_back(std::make_unique<ZipArchive>(bytes));
+    const ZipArchive &archive = *archives.back();
+    for (const ZipEntry &entry : archive.getEntries()) {
+      if (isIndexed(entry.name)) {
+        classes.push_back(ClassSource{&archive, &entry, origin + "!/" + std::string(entry.name)});
+      } else if (endsWith(entry.name, ".jar")) {
+        std::string nestedOrigin = origin + "!/" + std::string(entry.name);
+        try {
+          auto buffer = std::make_unique<std::vector<uint8_t>>();
+          ByteView nested = archive.read(entry, *buffer);
+          nestedJars.push_back(std::move(buffer));
+          addArchive(nested, nestedOrigin);
+        } catch (const std::exception &e) {
+          logger->warn("Skipping {}: {}", nestedOrigin, e.what());
+        }
+      }
+    }
+  }
+
+  void addFile(const std::filesystem::path &path) {
+    if (path.extension() == ".class") {
+      classes.push_back(ClassSource{nullptr, nullptr, path.string()});
+    } else {
+      files.push_back(std::make_unique<MappedFile>(path.string()));
+      addArchive(files.back()->getBytes(), path.string());
+    }
+  }
+
+public:
+  std::vector<ClassSource> classes;
+
+  /**
+   * Add a class file, jar or directory, throws if a file can't be read
+   */
+  void add(const std::string &input) {
+    std::filesystem::path path(input);
+    if (!std::filesystem::is_directory(path)) {
+      addFile(path);
+      return;
+    }
+
+    // Sorted for a deterministic choice among duplicate classes
+    std::vector<std::filesystem::path> found;
+    for (const auto &file : std::filesystem::recursive_directory_iterator(path)) {
+      std::string extension = file.path().extension().string();
+      if (file.is_regular_file() && (extension == ".class" || extension == ".jar")) {
+        if (file.path().filename() != "module-info.class") { found.push_back(file.path()); }
+      }
+    }
+    std::sort(found.begin(), found.end());
+    for (const std::filesystem::path &file : found) {
+      addFile(file);
+    }
+  }
+};
+
+static void indexClass(ByteView bytes, size_t task, WorkerResult &result) {
+  ClassFile classFile(bytes);
+  const ConstPool &constPool = classFile.getConstPool();
+  std::string_view internalName = constPool.getClassName(classFile.getThisClass());
+  std::string className = toJavaClassName(internalName);
+
+  for (const MemberInfo &member : classFile.getMethods()) {
+    const AttributeInfo *codeAttribute = classFile.findAttribute(member.attributes, "Code");
+    if (codeAttribute == nullptr) { continue; }
+
+    std::string_view methodName = constPool.getUtf8(member.nameIndex);
+    std::string_view descriptor = constPool.getUtf8(member.descriptorIndex);
+    try {
+      CodeInfo info = classFile.readCode(*codeAttribute);
+      const AttributeInfo *variables = classFile.findAttribute(info.attributes, "LocalVariableTable");
+      LocalVariableTable localVariables =
+          variables == nullptr ? LocalVariableTable() : classFile.readLocalVariableTable(*variables);
+      CodeAttribute code(classFile.getBytes().subview(info.codeOffset, info.codeLength), localVariables);
+      Method method(className, methodName, descriptor, member.accessFlags);
+
+      // Same hash as the agent computes over the loaded code and the constant pool reconstituted by JVMTI
+      result.methods.push_back(IndexedMethod{task, BlameIndex::methodKey(internalName, methodName, descriptor),
+                                             hashMethodCode(code, constPool, localVariables),
+                                             describeNPEInstructions(method, constPool, code, localVariables,
+                                                                     &info.handlerPcs)});
+    } catch (const std::exception &e) {
+      // Left out of the index, the agent analyzes it at run time
+      logger->debug("Failed to index {}.{}{}: {}", className, methodName, descriptor, e.what());
+      result.failedMethods++;
+    }
+  }
+  result.classes++;
+}
+
+int main(int argc, char **argv) {
+  size_t threads = 0;
+  std::string output;
+  std::vector<std::string> paths;
+  for (int i = 1; i < argc; i++) {
+    if (std::strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+      threads = std::strtoul(argv[++i], nullptr, 10);
+    } else if (std::strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+      output = argv[++i];
+    } else {
+      paths.emplace_back(argv[i]);
+    }
+  }
+  if (paths.empty() || output.empty()) {
+    std::fprintf(stderr, "Usage: npeblame-indexer [-j threads] -o file.idx <jar|directory|class>...\n");
+    return 1;
+  }
+  spdlog::set_level(spdlog::level::warn);
+  auto start = std::chrono::steady_clock::now();
+
+  Inputs inputs;
+  try {
+    for (const std::string &path : paths) {
+      inputs.add(path);
+    }
+  } catch (const std::exception &e) {
+    std::fprintf(stderr, "%s\n", e.what());
+    return 1;
+  }
+
+  WorkStealingPool pool(threads);
+  std::vector<WorkerResult> results(pool.getThreadCount());
+  pool.run(inputs.classes.size(), [&](size_t task, size_t worker) {
+    const ClassSource &source = inputs.classes[task];
+    WorkerResult &result = results[worker];
+    try {
+      if (source.archive != nullptr) {
+        indexClass(source.archive->read(*source.entry, result.buffer), task, result);
+      } else {
+        MappedFile file(source.path);
+        indexClass(file.getBytes(), task, result);
+      }
+    } catch (const std::exception &e) {
+      logger->warn("Skipping {}: {}", source.path, e.what());
+      result.failedClasses++;
+    }
+  });
+
+  // A class in several inputs is indexed from the first one, as a class path would load it
+  WorkerResult total;
+  for (WorkerResult &result : results) {
+    std::move(result.methods.begin(), result.methods.end(), std::back_inserter(total.methods));
+    total.classes += result.classes;
+    total.failedClasses += result.failedClasses;
+    total.failedMethods += result.failedMethods;
+  }
+  std::sort(total.methods.begin(), total.methods.end(), [](const IndexedMethod &a, const IndexedMethod &b) {
+    return a.key != b.key ? a.key < b.key : a.task < b.task;
+  });
+
+  total.methods.erase(std::unique(total.methods.begin(), total.methods.end(),
+                                  [](const IndexedMethod &a, const IndexedMethod &b) { return a.key == b.key; }),
+                      total.methods.end());
+
+  BlameIndex::Builder builder;
+  size_t sites = 0;
+  for (IndexedMethod &method : total.methods) {
+    sites += method.sites.size();
+    builder.addMethod(std::move(method.key), method.codeHash, std::move(method.sites));
+  }
+
+  try {
+    builder.write(output);
+  } catch (const std::exception &e) {
+    std::fprintf(stderr, "%s\n", e.what());
+    return 1;
+  }
+
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  std::printf("Indexed %zu classes, %zu methods, %zu NPE sites in %.2f s with %zu threads\n", total.classes,
+              builder.size(), sites, seconds, pool.getThreadCount());
+  if (total.failedClasses > 0 || total.failedMethods > 0) {
+    std::printf("Skipped %zu classes and %zu methods that failed to parse or analyze\n", total.failedClasses,
+                total.failedMethods);
+  }
+  return 0;
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+
+/**
+ * Runs tasks numbered 0 to count - 1 on a fixed number of threads. Each thread starts with an equal range of tasks
+ * and takes from its front, a thread that runs out steals the back half of another thread's range, so uneven
+ * tasks like large and tiny classes still keep all threads busy.
+ */
+class WorkStealingPool {
+  size_t threadCount;
+
+public:
+  /**
+   * @param threads number of threads, 0 for one per hardware thread
+   */
+  explicit WorkStealingPool(size_t threads);
+
+  size_t getThreadCount() const { return threadCount; }
+
+  /**
+   * Run all tasks and block until they are done. After a task throws no further tasks are started,
+   * the first exception is rethrown.
+   */
+  void run(size_t taskCount, const std::function<void(size_t task, size_t worker)> &task);
+};
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+#include "bytecode/ByteView.h"
+
+struct ZipEntry {
+  std::string_view name; // Points into the central directory
+  uint16_t flags;
+  uint16_t method;
+  uint64_t compressedSize;
+  uint64_t uncompressedSize;
+  uint64_t localHeaderOffset;
+};
+
+/**
+ * Read-only zip archive over bytes owned elsewhere, e.g. a MappedFile or a stored entry of an outer jar.
+ * Only the central directory is parsed upfront, stored entries are returned in place and deflated ones are
+ * inflated on demand. Zip64 archives and data prepended to the archive, e.g. launch scripts, are supported.
+ */
+class ZipArchive {
+  ByteView bytes;
+  // Offset of the archive in bytes, non-zero if something was prepended to it
+  uint64_t base = 0;
+  std::vector<ZipEntry> entries;
+
+  size_t findEndOfCentralDirectory() const;
+
+public:
+  static constexpr uint16_t STORED = 0;
+  static constexpr uint16_t DEFLATED = 8;
+
+  /**
+   * Throws std::runtime_error if the bytes are not a zip archive
+   */
+  explicit ZipArchive(ByteView bytes);
+
+  const std::vector<ZipEntry> &getEntries() const { return entries; }
+
+  /**
+   * Contents of an entry, in place if stored, otherwise inflated into buffer.
+   * Throws std::runtime_error for encrypted entries, unsupported compression or corrupt data
+   */
+  ByteView read(const ZipEntry &entry, std::vector<uint8_t> &buffer) const;
+};
@@ -1,13 +1,17 @@
 #include "analyzer.h"
 
+#include <optional>
 #include <string_view>
 
 #include "bytecode/Field.h"
+#include "bytecode/StackAnalysis.h"
 #include "exceptions.h"
 #include "util.h"
 
 using fmt::literals::operator ""_format;
 
+static auto logger = getLogger("Analyzer");
+
 int getStackDelta(const CodeAttribute &code, const ConstPool &constPool, size_t off, int stackExcess) {
   uint8_t opCode = code.getOpcode(off);
   if (opCode == OpCodes::WIDE) {
@@ -16,14 +20,15 @@ int getStackDelta(const CodeAttribute &code, const ConstPool &constPool, size_t
            opCode >= OpCodes::ILOAD && opCode <= OpCodes::ALOAD ||
            opCode >= OpCodes::ISTORE && opCode <= OpCodes::ASTORE);
   }
-  int delta = Constants::OpCodeStackDelta[opCode];
+  const OpcodeInfo &info = opcodeInfo(opCode);
+  bool shufflesStack = opCode >= OpCodes::DUP_X1 && opCode <= OpCodes::SWAP;
 
-  if (delta != -127 && delta != 127) { return delta; }
+  if (info.pops != OpcodeInfo::VARIES && !shufflesStack) { return info.pushes - info.pops; }
 
   if (opCode >= OpCodes::INVOKEVIRTUAL && opCode <= OpCodes::INVOKEINTERFACE) {
     auto invokedMethod = Method::readFromCodeInvoke(code, constPool, off);
     int invokeStackDelta = -invokedMethod.getParameterLength();
-    if (invokedMethod.getReturnType() != "void") { invokeStackDelta++; }
+    invokeStackDelta += invokedMethod.getReturnLength();
     if (opCode == OpCodes::INVOKEVIRTUAL || opCode == OpCodes::INVOKEINTERFACE ||
         opCode == OpCodes::INVOKESPECIAL) { invokeStackDelta--; }
     return invokeStackDelta;
@@ -35,8 +40,7 @@ int getStackDelta(const CodeAttribute &code, const ConstPool &constPool, size_t
   }
 
   if (opCode >= OpCodes::GETSTATIC && opCode <= OpCodes::PUTFIELD) {
-    std::string fieldType = Field::readFromFieldInsn(code, constPool, off).getTypeName();
-    int fieldTypeSize = (fieldType == "long" || fieldType == "double") ? 2 : 1;
+    int fieldTypeSize = Field::readFromFieldInsn(code, constPool, off).getTypeLength();
     switch (opCode) {
       case OpCodes::GETSTATIC:
         return fieldTypeSize;
@@ -114,99 +118,160 @@ int getStackDelta(const CodeAttribute &code, const ConstPool &constPool, size_t
   }
 
   throw InvalidArgument(
-      "Unsupported opcode for calculating stack delta: {}"_format(Constants::OpcodeMnemonic[opCode]));
+      "Unsupported opcode for calculating stack delta: {}"_format(opcodeInfo(opCode).mnemonic));
 }
 
-std::string traceDetailedCause(const Method &currentFrameMethod,
-                               const ConstPool &constPool,
-                               const CodeAttribute &code,
-                               const LocalVariableTable &vars,
-                               size_t location,
-                               int stackExcess) {
-  const std::vector<size_t> &instructions = code.getInstructions();
-  size_t ins = 0;
-  for (size_t off : instructions) {
-    if (off == location) { break; }
-    ins++;
+/**
+ * Describe the value pushed by the instruction at offset, empty if the instruction does not identify a source
+ */
+static std::optional<std::string> describeProducer(const Method &currentFrameMethod,
+                                                   const ConstPool &constPool,
+                                                   const CodeAttribute &code,
+                                                   const LocalVariableTable &vars,
+                                                   size_t off) {
+  uint8_t opCode = code.getOpcode(off);
+  bool wide = false;
+  if (opCode == OpCodes::WIDE) {
+    wide = true;
+    opCode = code.getOpcode(off + 1);
   }
 
+  if (opCode >= OpCodes::ILOAD && opCode <= OpCodes::ALOAD_3) {
+    uint16_t slot;
+    if (opCode <= OpCodes::ALOAD) {
+      if (wide) {
+        slot = ByteVectorUtil::readuint16(code.getCode(), off + 2);
+      } else {
+        slot = ByteVectorUtil::readuint8(code.getCode(), off + 1);
+      }
+    } else {
+      slot = opcodeSlot(opCode);
+    }
+
+    size_t methodParamsLength = currentFrameMethod.getParameterLength();
+    bool isMethodParam = slot < methodParamsLength + (currentFrameMethod.isStatic() ? 0 : 1);
+
+    auto optVarInfo = vars.getEntry(slot);
+    if (optVarInfo.has_value()) {
+      auto[name, signature] = *optVarInfo;
+      return "{} {}:{}"_format(isMethodParam ? "method parameter" : "local variable", name, toJavaTypeName(signature));
+    } else {
+      if (isMethodParam) {
+        int index = currentFrameMethod.isStatic() ? 1 : 0;
+        int paramSlot = 0;
+        for (std::string_view param : currentFrameMethod.getParameterTypes()) {
+          if (param == "long" || param == "double") {
+            paramSlot += 2;
+          } else {
+            paramSlot++;
+          }
+          index++;
+          if (paramSlot == slot) break;
+        }
+        return "method parameter at index {}"_format(index);
+      } else {
+        return "local variable in slot {}"_format(slot);
+      }
+    }
+  } else if (opCode == OpCodes::ACONST_NULL) {
+    return "constant";
+  } else if (opCode == OpCodes::GETFIELD) {
+    Field field = Field::readFromFieldInsn(code, constPool, off);
+    return "instance field " + field.getClassName() + "." + field.getFieldName();
+  } else if (opCode == OpCodes::GETSTATIC) {
+    Field field = Field::readFromFieldInsn(code, constPool, off);
+    return "static field " + field.getClassName() + "." + field.getFieldName();
+  }
+    //TODO: Manually generated bytecode for indy? does it throw npe? javac prepends implicit null check with getClass/Objects.requireNonNull
+    //Parse BootStrapmethod and get MethodType passed to LambdaMetaFactory to determine which method ref was taken
+    //Diff between method ref and lambda?
+  else if (opCode >= OpCodes::INVOKEVIRTUAL && opCode <= OpCodes::INVOKEINTERFACE) {
+    auto invokedMethod = Method::readFromCodeInvoke(code, constPool, off);
+
+    if (invokedMethod.getReturnType() != "void") {
+      return "object returned from {}#{}"_format(invokedMethod.getClassName(), invokedMethod.getMethodName());
+    }
+  }
+
+  return std::nullopt;
+}
+
+/**
+ * Walk straight backwards from location, only correct if no branch targets are in between
+ */
+static std::string traceCauseBackwards(const Method &currentFrameMethod,
+                                       const ConstPool &constPool,
+                                       const CodeAttribute &code,
+                                       const LocalVariableTable &vars,
+                                       size_t location,
+                                       int stackExcess) {
+  const std::vector<uint16_t> &instructions = code.getInstructions();
+  size_t ins = code.getInstructionIndex(location);
+
   while (stackExcess >= 0 && ins != 0) {
     size_t off = instructions[--ins];
 
     int stackDelta = getStackDelta(code, constPool, off, stackExcess);
-    uint8_t opCode = code.getOpcode(off);
-    bool wide = false;
-    if (opCode == OpCodes::WIDE) {
-      wide = true;
-      opCode = code.getOpcode(off + 1);
-    }
 
-    getLogger("Analyzer")->trace("Op: {}, delta: {}, excess: {}", Constants::OpcodeMnemonic[opCode], stackDelta, stackExcess);
+    logger->trace("Op: {}, delta: {}, excess: {}", opcodeInfo(code.getOpcode(off)).mnemonic, stackDelta, stackExcess);
     stackExcess -= stackDelta;
     if (stackExcess > 0 || stackExcess == 0 && stackDelta != 0) {
       continue;
     }
 
+    if (auto description = describeProducer(currentFrameMethod, constPool, code, vars, off); description.has_value()) {
+      return *description;
+    }
+  }
 
-    if (opCode >= OpCodes::ILOAD && opCode <= OpCodes::ALOAD_3) {
-      uint16_t slot;
-      if (opCode <= OpCodes::ALOAD) {
-        if (wide) {
-          slot = ByteVectorUtil::readuint16(code.getCode(), off + 2);
-        } else {
-          slot = ByteVectorUtil::readuint8(code.getCode(), off + 1);
-        }
-      } else {
-        slot = opcodeSlot(opCode);
-      }
+  return "UNKNOWN";
+}
 
-      size_t methodParamsLength = currentFrameMethod.getParameterLength();
-      bool isMethodParam = slot < methodParamsLength + (currentFrameMethod.isStatic() ? 0 : 1);
+static std::string describeProducerOffset(const Method &currentFrameMethod,
+                                          const ConstPool &constPool,
+                                          const CodeAttribute &code,
+                                          const LocalVariableTable &vars,
+                                          uint32_t producer) {
+  if (producer == StackAnalysis::UNKNOWN || producer == StackAnalysis::CAUGHT_EXCEPTION) {
+    return "UNKNOWN";
+  }
+  return describeProducer(currentFrameMethod, constPool, code, vars, producer).value_or("UNKNOWN");
+}
 
-      auto optVarInfo = vars.getEntry(slot);
-      if (optVarInfo.has_value()) {
-        auto[name, signature] = *optVarInfo;
-        return "{} {}:{}"_format(isMethodParam ? "method parameter" : "local variable", name, toJavaTypeName(signature));
-      } else {
-        if (isMethodParam) {
-          int index = currentFrameMethod.isStatic() ? 1 : 0;
-          int paramSlot = 0;
-          for (std::string_view param : currentFrameMethod.getParameterTypes()) {
-            if (param == "long" || param == "double") {
-              paramSlot += 2;
-            } else {
-              paramSlot++;
-            }
-            index++;
-            if (paramSlot == slot) break;
-          }
-          return "method parameter at index {}"_format(index);
-        } else {
-          return "local variable in slot {}"_format(slot);
-        }
-      }
-    } else if (opCode == OpCodes::ACONST_NULL) {
-      return "constant";
-    } else if (opCode == OpCodes::GETFIELD) {
-      Field field = Field::readFromFieldInsn(code, constPool, off);
-      return "instance field " + field.getClassName() + "." + field.getFieldName();
-    } else if (opCode == OpCodes::GETSTATIC) {
-      Field field = Field::readFromFieldInsn(code, constPool, off);
-      return "static field " + field.getClassName() + "." + field.getFieldName();
-    }
-      //TODO: Manually generated bytecode for indy? does it throw npe? javac prepends implicit null check with getClass/Objects.requireNonNull
-      //Parse BootStrapmethod and get MethodType passed to LambdaMetaFactory to determine which method ref was taken
-      //Diff between method ref and lambda?
-    else if (opCode >= OpCodes::INVOKEVIRTUAL && opCode <= OpCodes::INVOKEINTERFACE) {
-      auto invokedMethod = Method::readFromCodeInvoke(code, constPool, off);
-
-      if (invokedMethod.getReturnType() != "void") {
-        return "object returned from {}#{}"_format(invokedMethod.getClassName(), invokedMethod.getMethodName());
+std::string traceDetailedCause(const Method &currentFrameMethod,
+                               const ConstPool &constPool,
+                               const CodeAttribute &code,
+                               const LocalVariableTable &vars,
+                               size_t location,
+                               int stackExcess,
+                               const StackMapTable *stackMap,
+                               const FlowProvider &flow) {
+  if (stackMap != nullptr) {
+    try {
+      const StackMapFrame &frame = stackMap->findFrameBefore(location);
+      uint32_t producer = StackAnalysis::getProducerAfterFrame(code, constPool, frame, location,
+                                                               static_cast<size_t>(stackExcess));
+      logger->trace("Null reference at {} pushed by instruction at {}, replayed from frame at {}", location, producer,
+                    frame.offset);
+      // Pushed before the frame, e.g. a receiver loaded before a conditional argument, needs the whole method
+      if (producer != StackAnalysis::FRAME_ENTRY) {
+        return describeProducerOffset(currentFrameMethod, constPool, code, vars, producer);
       }
+    } catch (const std::exception &e) {
+      logger->debug("Replaying from stack map frame failed: {}", e.what());
     }
   }
 
-  return "UNKNOWN";
+  try {
+    StackAnalysis analysis = flow ? StackAnalysis(code, constPool, flow()) : StackAnalysis(code, constPool);
+    uint32_t producer = analysis.getProducer(location, static_cast<size_t>(stackExcess));
+    logger->trace("Null reference at {} pushed by instruction at {}", location, producer);
+    return describeProducerOffset(currentFrameMethod, constPool, code, vars, producer);
+  } catch (const std::exception &e) {
+    logger->debug("Stack analysis failed, walking backwards instead: {}", e.what());
+  }
+
+  return traceCauseBackwards(currentFrameMethod, constPool, code, vars, location, stackExcess);
 }
 
 std::string arrayType(uint8_t opCode) {
@@ -236,53 +301,177 @@ std::string arrayType(uint8_t opCode) {
   }
 }
 
-std::string describeNPEInstruction(const Method &currentFrameMethod, const ConstPool &cp, const CodeAttribute &code,
-                                   const LocalVariableTable &vars, size_t location) {
-  std::string errorSource;
-  int stackExcess;
+static bool isRequireNonNull(const Method &method) {
+  return method.getClassName() == "java.util.Objects" && method.getMethodName() == "requireNonNull";
+}
 
+/**
+ * What the instruction at location does with the null reference, and how many slots the reference is below the top
+ * of the stack. Empty if the instruction cannot throw an NPE
+ */
+static std::optional<std::pair<std::string, int>> describeNullUse(const ConstPool &cp, const CodeAttribute &code,
+                                                                  size_t location) {
   uint8_t op = code.getOpcode(location);
-  if (op >= OpCodes::INVOKEVIRTUAL && op <= OpCodes::INVOKEDYNAMIC) {
-    Method method = Method::readFromCodeInvoke(code, cp, location);
-
-    if (method.getClassName() == "java.util.Objects" && method.getMethodName() == "requireNonNull") {
-      errorSource = "Assertion Objects#requireNonNull failed for null ";
-      stackExcess = 0;
-    } else {
-      errorSource = "Invoking {}#{} on null "_format(method.getClassName(), method.getMethodName());
-      stackExcess = method.getParameterLength();
-    }
-  } else if (op >= OpCodes::GETFIELD && op <= OpCodes::PUTFIELD) {
-    Field field = Field::readFromFieldInsn(code, cp, location);
-    std::string putOrGet;
+  const OpcodeInfo &info = opcodeInfo(op);
 
-    if (op == OpCodes::GETFIELD) {
-      putOrGet = "Getting";
-      stackExcess = 0;
-    } else {
-      putOrGet = "Setting";
-      stackExcess = 1;
-    }
+  // javac emits Objects#requireNonNull for implicit null checks, the NPE thrown inside is reported at the call
+  if (op == OpCodes::INVOKESTATIC && isRequireNonNull(Method::readFromCodeInvoke(code, cp, location))) {
+    return std::make_pair(std::string("Assertion Objects#requireNonNull failed for null "), 0);
+  }
+  if (!info.canThrowNPE()) { return std::nullopt; }
 
-    errorSource = putOrGet + " field " + field.getClassName() + "." + field.getFieldName() + " of null ";
+  if (op >= OpCodes::INVOKEVIRTUAL && op <= OpCodes::INVOKEINTERFACE) {
+    Method method = Method::readFromCodeInvoke(code, cp, location);
+    return std::make_pair("Invoking {}#{} on null "_format(method.getClassName(), method.getMethodName()),
+                          method.getParameterLength());
+  } else if (op == OpCodes::GETFIELD || op == OpCodes::PUTFIELD) {
+    Field field = Field::readFromFieldInsn(code, cp, location);
+    std::string putOrGet = op == OpCodes::GETFIELD ? "Getting" : "Setting";
+    return std::make_pair(putOrGet + " field " + field.getClassName() + "." + field.getFieldName() + " of null ",
+                          op == OpCodes::GETFIELD ? info.nullCheckDepth : field.getTypeLength());
   } else if (op >= OpCodes::IASTORE && op <= OpCodes::SASTORE) {
-    errorSource = "Storing " + arrayType(op) + "to null array - ";
-    stackExcess = op == OpCodes::DASTORE || op == OpCodes::LASTORE ? 3 : 2;
+    return std::make_pair("Storing " + arrayType(op) + "to null array - ", info.nullCheckDepth);
   } else if (op >= OpCodes::IALOAD && op <= OpCodes::SALOAD) {
-    errorSource = "Loading " + arrayType(op) + "from null array - ";
-    stackExcess = 1;
+    return std::make_pair("Loading " + arrayType(op) + "from null array - ", info.nullCheckDepth);
   } else if (op == OpCodes::ARRAYLENGTH) {
-    errorSource = "Getting array length of null ";
-    stackExcess = 0;
+    return std::make_pair(std::string("Getting array length of null "), info.nullCheckDepth);
   } else if (op == OpCodes::ATHROW) {
-    errorSource = "Throwing null ";
-    stackExcess = 0;
-  } else if (op == OpCodes::MONITORENTER || op == OpCodes::MONITOREXIT) {
-    errorSource = "Synchronizing on null ";
-    stackExcess = 0;
-  } else {
+    return std::make_pair(std::string("Throwing null "), info.nullCheckDepth);
+  }
+  return std::make_pair(std::string("Synchronizing on null "), info.nullCheckDepth);
+}
+
+std::string describeNPEInstruction(const Method &currentFrameMethod, const ConstPool &cp, const CodeAttribute &code,
+                                   const LocalVariableTable &vars, size_t location,
+                                   const StackMapTable *stackMap, const FlowProvider &flow) {
+  auto nullUse = describeNullUse(cp, code, location);
+  if (!nullUse.has_value()) {
     return "[Unknown NPE cause] ";
   }
 
-  return errorSource + traceDetailedCause(currentFrameMethod, cp, code, vars, location, stackExcess);
-}
\ No newline at end of file
+  auto &[errorSource, stackExcess] = *nullUse;
+  return errorSource + traceDetailedCause(currentFrameMethod, cp, code, vars, location, stackExcess, stackMap,
+                                          flow);
+}
+
+/**
+ * Instructions the VM can throw an NPE at. Only Objects#requireNonNull is described for static invokes,
+ * and constructor invocations are never on a null reference.
+ */
+static bool canThrowNPE(const ConstPool &cp, const CodeAttribute &code, size_t location) {
+  uint8_t op = code.getOpcode(location);
+  if (op == OpCodes::INVOKESTATIC) {
+    return isRequireNonNull(Method::readFromCodeInvoke(code, cp, location));
+  }
+  if (op == OpCodes::INVOKESPECIAL) {
+    return Method::readFromCodeInvoke(code, cp, location).getMethodName() != "<init>";
+  }
+  return opcodeInfo(op).canThrowNPE();
+}
+
+std::vector<std::pair<size_t, std::string>> describeNPEInstructions(const Method &currentFrameMethod,
+                                                                    const ConstPool &cp,
+                                                                    const CodeAttribute &code,
+                                                                    const LocalVariableTable &vars,
+                                                                    const std::vector<uint16_t> *handlerPcs) {
+  std::vector<std::pair<size_t, std::string>> descriptions;
+
+  std::optional<StackAnalysis> analysis;
+  try {
+    analysis.emplace(code, cp, handlerPcs);
+  } catch (const std::exception &e) {
+    logger->debug("Stack analysis failed, walking backwards instead: {}", e.what());
+  }
+
+  if (analysis.has_value()) {
+    analysis->visitInstructions([&](size_t location, const std::vector<uint32_t> &stack) {
+      if (!canThrowNPE(cp, code, location)) { return; }
+
+      auto [errorSource, stackExcess] = *describeNullUse(cp, code, location);
+      uint32_t producer = static_cast<size_t>(stackExcess) < stack.size() ? stack[stack.size() - 1 - stackExcess]
+                                                                           : StackAnalysis::UNKNOWN;
+      descriptions.emplace_back(location,
+                                errorSource + describeProducerOffset(currentFrameMethod, cp, code, vars, producer));
+    });
+    // Blocks are visited in order of their offsets, so are the instructions
+    return descriptions;
+  }
+
+  for (size_t location : code.getInstructions()) {
+    if (!canThrowNPE(cp, code, location)) { continue; }
+
+    auto [errorSource, stackExcess] = *describeNullUse(cp, code, location);
+    descriptions.emplace_back(
+        location, errorSource + traceCauseBackwards(currentFrameMethod, cp, code, vars, location, stackExcess));
+  }
+  return descriptions;
+}
+
+/**
+ * Continue hash over a name, terminated by a zero byte that modified UTF-8 never contains
+ */
+static uint64_t hashName(std::string_view name, uint64_t hash) {
+  static constexpr uint8_t TERMINATOR = 0;
+  hash = ByteVectorUtil::hash(ByteView(reinterpret_cast<const uint8_t *>(name.data()), name.size()), hash);
+  return ByteVectorUtil::hash(ByteView(&TERMINATOR, 1), hash);
+}
+
+template<typename T>
+static uint64_t hashValue(T value, uint64_t hash) {
+  return ByteVectorUtil::hash(ByteView(reinterpret_cast<const uint8_t *>(&value), sizeof(value)), hash);
+}
+
+/**
+ * Continue hash over the resolved entry, MethodHandle, MethodType and Dynamic constants only by their tag
+ */
+static uint64_t hashEntry(const ConstPool &cp, size_t index, uint64_t hash) {
+  uint8_t tag = cp.getTag(index);
+  hash = hashValue(tag, hash);
+  switch (tag) {
+    case CpInfo::Integer:
+      return hashValue(cp.getInteger(index), hash);
+    case CpInfo::Float:
+      return hashValue(cp.getFloat(index), hash);
+    case CpInfo::Long:
+      return hashValue(cp.getLong(index), hash);
+    case CpInfo::Double:
+      return hashValue(cp.getDouble(index), hash);
+    case CpInfo::Class:
+      return hashName(cp.getClassName(index), hash);
+    case CpInfo::String:
+      return hashName(cp.getString(index), hash);
+    case CpInfo::Fieldref:
+    case CpInfo::Methodref:
+    case CpInfo::InterfaceMethodref: {
+      MemberRef member = cp.getMemberRef(index);
+      return hashName(member.descriptor, hashName(member.name, hashName(member.className, hash)));
+    }
+    case CpInfo::InvokeDynamic: {
+      NameAndTypeRef nameAndType = cp.getInvokeDynamic(index);
+      return hashName(nameAndType.descriptor, hashName(nameAndType.name, hash));
+    }
+    default:
+      return hash;
+  }
+}
+
+uint64_t hashMethodCode(const CodeAttribute &code, const ConstPool &cp, const LocalVariableTable &vars) {
+  ByteView bytes = code.getCode();
+  uint64_t hash = ByteVectorUtil::hash(bytes);
+  for (size_t location : code.getInstructions()) {
+    switch (opcodeInfo(code.getOpcode(location)).operands) {
+      case Operands::ConstPool8:
+        hash = hashEntry(cp, bytes[location + 1], hash);
+        break;
+      case Operands::ConstPool16:
+      case Operands::InvokeInterface:
+      case Operands::InvokeDynamic:
+      case Operands::MultiANewArray:
+        hash = hashEntry(cp, ByteVectorUtil::readuint16(bytes, location + 1), hash);
+        break;
+      default:
+        break;
+    }
+  }
+  return vars.hash(hash);
+}
@@ -4,7 +4,12 @@
 #include <jvmti.h>
 #include <tuple>
 
+#include "classLoadHook.h"
+#include "cache/ClassRegistry.h"
 #include "exceptionCallback.h"
+#include "lazyMessages.h"
+#include "npeHook.h"
+#include "options.h"
 #include "api/Jni.h"
 
 
@@ -22,17 +27,36 @@ void Jvmti::init(JavaVM *vm) {
   jvmtiEventCallbacks callbacks = {nullptr};
   jvmtiCapabilities caps = {0};
 
+  const AgentOptions &options = AgentOptions::get();
+
   caps.can_get_bytecodes = 1;
-  caps.can_generate_exception_events = 1;
   caps.can_get_line_numbers = 1;
   caps.can_get_constant_pool = 1;
   caps.can_access_local_variables = 1;
+  caps.can_tag_objects = 1;
+  // Only sent for tagged objects, i.e. classes and loaders the agent caches something for
+  caps.can_generate_object_free_events = 1;
+  // Even possessing the exception events capability disables some exception optimizations in the JIT
+  if (options.mode == BlameMode::Event) {
+    caps.can_generate_exception_events = 1;
+  } else {
+    caps.can_retransform_classes = 1;
+  }
 
   jvmtiError err = initEnv->AddCapabilities(&caps);
   checkError(err);
 
-  callbacks.Exception = &exceptionCallback;
   callbacks.VMInit = &vmInit;
+  callbacks.ObjectFree = &objectFree;
+  if (options.mode == BlameMode::Event) {
+    callbacks.Exception = &exceptionCallback;
+  }
+  if (options.mode == BlameMode::Event && options.threadEvents) {
+    callbacks.ThreadStart = &threadStart;
+  }
+  if (options.mode == BlameMode::Hook || options.classImages) {
+    callbacks.ClassFileLoadHook = &classFileLoadHook;
+  }
 
   err = initEnv->SetEventCallbacks(&callbacks, sizeof(callbacks));
   checkError(err);
@@ -40,10 +64,91 @@ void Jvmti::init(JavaVM *vm) {
   err = initEnv->SetEventNotificationMode(JVMTI_ENABLE, JVMTI_EVENT_VM_INIT, nullptr);
   checkError(err);
 
-  err = initEnv->SetEventNotificationMode(JVMTI_ENABLE, JVMTI_EVENT_EXCEPTION, nullptr);
+  err = initEnv->SetEventNotificationMode(JVMTI_ENABLE, JVMTI_EVENT_OBJECT_FREE, nullptr);
   checkError(err);
 
+  // With threadEvents, exception events are enabled for each thread once the VM is initialized
+  if (options.mode == BlameMode::Event && options.threadEvents) {
+    err = initEnv->SetEventNotificationMode(JVMTI_ENABLE, JVMTI_EVENT_THREAD_START, nullptr);
+    checkError(err);
+  } else if (options.mode == BlameMode::Event) {
+    err = initEnv->SetEventNotificationMode(JVMTI_ENABLE, JVMTI_EVENT_EXCEPTION, nullptr);
+    checkError(err);
+  }
+
+  // Hook mode enables load events itself once the hook class is defined
+  if (options.classImages) {
+    err = initEnv->SetEventNotificationMode(JVMTI_ENABLE, JVMTI_EVENT_CLASS_FILE_LOAD_HOOK, nullptr);
+    checkError(err);
+  }
+
   env = initEnv;
+
+  // VMInit is not sent when attaching to a running VM
+  jvmtiPhase phase;
+  err = initEnv->GetPhase(&phase);
+  checkError(err);
+  if (phase == JVMTI_PHASE_LIVE) {
+    JNIEnv *jni = nullptr;
+    if (vm->GetEnv((void **) &jni, JNI_VERSION_1_6) != JNI_OK) {
+      throw JniError("Failed to acquire JNI environment");
+    }
+    vmInit(initEnv, jni, nullptr);
+  }
+}
+
+void JNICALL Jvmti::vmInit(jvmtiEnv *jvmti_env, JNIEnv *jni_env, jthread thread) {
+  logger->debug("VMInit\n");
+
+  try {
+    ensureInit(jvmti_env);
+    Jni::ensureInit(jni_env);
+    initExceptionFilter(jni_env);
+    Jni::bindWellKnownMembers();
+
+    if (AgentOptions::get().mode == BlameMode::Event && AgentOptions::get().threadEvents) {
+      enableThreadExceptionEvents();
+    }
+    bool lazy = AgentOptions::get().lazyMessages || AgentOptions::get().localCatch == CatchAction::Lazy;
+    if (lazy && !LazyMessages::install(jvmti_env, jni_env)) {
+      logger->warn("Lazy messages require JDK 14+, NPEs are described when thrown");
+    }
+
+    if (AgentOptions::get().mode == BlameMode::Hook) {
+      installNpeHook(jvmti_env, jni_env);
+    }
+  } catch (const std::exception &e) {
+    logger->error("Failed to initialize agent: {}", e.what());
+  }
+}
+
+void JNICALL Jvmti::threadStart(jvmtiEnv *jvmti_env, JNIEnv *jni_env, jthread thread) {
+  try {
+    ensureInit(jvmti_env);
+    setExceptionEvents(thread, true);
+  } catch (const std::exception &e) {
+    logger->error("Failed to enable exception events for a new thread: {}", e.what());
+  }
+}
+
+void JNICALL Jvmti::objectFree(jvmtiEnv *jvmti_env, jlong tag) {
+  // Recorded NPEs are tagged too, their tags are far above class handles
+  if (!LazyMessages::release(tag)) { ClassRegistry::objectFree(jvmti_env, tag); }
+}
+
+void Jvmti::enableThreadExceptionEvents() {
+  jint threadCount;
+  jthread *threads;
+  jvmtiError err = env->GetAllThreads(&threadCount, &threads);
+  checkError(err);
+
+  // A thread started meanwhile may be enabled twice, which has no effect
+  for (jint i = 0; i < threadCount; i++) {
+    setExceptionEvents(threads[i], true);
+    Jni::deleteLocalRef(threads[i]);
+  }
+  err = env->Deallocate((unsigned char *) threads);
+  checkError(err);
 }
 
 bool Jvmti::isMethodNative(jmethodID method) {
@@ -72,35 +177,36 @@ jclass Jvmti::getMethodDeclaringClass(jmethodID method) {
   return methodClass;
 }
 
-std::vector<uint8_t> Jvmti::getBytecodes(jmethodID method) {
-  jvmtiError err;
-
+JvmtiBuffer Jvmti::getBytecodes(jmethodID method) {
   jint length;
   uint8_t *bytes;
 
-  err = env->GetBytecodes(method, &length, &bytes);
-  checkError(err);
-  std::vector<uint8_t> methodBytecode(bytes, bytes + length);
-  err = env->Deallocate(bytes);
+  jvmtiError err = env->GetBytecodes(method, &length, &bytes);
   checkError(err);
 
-  return methodBytecode;
+  return JvmtiBuffer(env, bytes, static_cast<size_t>(length));
 }
 
-ConstPool Jvmti::getConstPool(jclass klass) {
+// The pool is parsed in place, it owns the JVMTI buffer it reads from
+struct BufferedConstPool {
+  JvmtiBuffer bytes;
+  ConstPool constPool;
+};
+
+std::shared_ptr<const ConstPool> Jvmti::getConstPool(jclass klass) {
   jint cpCount;
   jint cpByteSize;
   uint8_t *constPoolBytes;
 
   jvmtiError err = env->GetConstantPool(klass, &cpCount, &cpByteSize, &constPoolBytes);
   checkError(err);
-  ConstPool constPool(std::vector<uint8_t>(constPoolBytes, constPoolBytes + cpByteSize));
-  err = env->Deallocate(constPoolBytes);
-  checkError(err);
 
-  assert(cpCount == constPool.size());
+  auto buffered = std::make_shared<BufferedConstPool>();
+  buffered->bytes = JvmtiBuffer(env, constPoolBytes, static_cast<size_t>(cpByteSize));
+  buffered->constPool = ConstPool(ByteView(buffered->bytes));
+  assert(cpCount == buffered->constPool.size());
 
-  return constPool;
+  return std::shared_ptr<const ConstPool>(buffered, &buffered->constPool);
 }
 
 uint32_t Jvmti::getMethodModifiers(jmethodID methodId) {
@@ -110,6 +216,27 @@ uint32_t Jvmti::getMethodModifiers(jmethodID methodId) {
   return static_cast<uint32_t>(modifiers);
 }
 
+std::string Jvmti::getClassSignature(jclass klass) {
+  char *classSignature;
+
+  jvmtiError err = env->GetClassSignature(klass, &classSignature, nullptr);
+  checkError(err);
+
+  std::string signature{classSignature};
+
+  err = env->Deallocate((uint8_t *) classSignature);
+  checkError(err);
+
+  return signature;
+}
+
+jobject Jvmti::getClassLoader(jclass klass) {
+  jobject loader;
+  jvmtiError err = env->GetClassLoader(klass, &loader);
+  checkError(err);
+  return loader;
+}
+
 std::pair<std::string, std::string> Jvmti::getMethodNameAndSignature(jmethodID methodId) {
   char *methodName;
   char *methodSignature;
@@ -166,11 +293,26 @@ uint32_t Jvmti::getFrameCount(jthread thread) {
   return static_cast<uint32_t>(count);
 }
 
-Method Jvmti::toMethod(jmethodID methodId) {
-  jclass declaringClass = getMethodDeclaringClass(methodId);
-  auto[name, signature] = getMethodNameAndSignature(methodId);
-  uint32_t modifiers = getMethodModifiers(methodId);
+void Jvmti::setExceptionEvents(jthread thread, bool enabled) {
+  jvmtiError err = env->SetEventNotificationMode(enabled ? JVMTI_ENABLE : JVMTI_DISABLE, JVMTI_EVENT_EXCEPTION, thread);
+  checkError(err);
+}
 
-  std::string className = Jni::invokeVirtual(declaringClass, "getName", jnisig("()Ljava/lang/String;"));
-  return Method(className, name, signature, modifiers);
+uint32_t Jvmti::getStackTrace(jthread thread, jvmtiFrameInfo *frames, uint32_t maxFrames) {
+  jint count;
+  jvmtiError err = env->GetStackTrace(thread, 0, static_cast<jint>(maxFrames), frames, &count);
+  checkError(err);
+  return static_cast<uint32_t>(count);
+}
+
+jlong Jvmti::getTag(jobject object) {
+  jlong tag;
+  jvmtiError err = env->GetTag(object, &tag);
+  checkError(err);
+  return tag;
+}
+
+void Jvmti::setTag(jobject object, jlong tag) {
+  jvmtiError err = env->SetTag(object, tag);
+  checkError(err);
 }
@@ -0,0 +1,36 @@
+#include "api/StackTrace.h"
+
+#include <memory>
+#include <vector>
+
+#include "api/Jvmti.h"
+
+// One buffer per nested trace, allocated once and kept for the lifetime of the thread
+static thread_local std::vector<std::unique_ptr<jvmtiFrameInfo[]>> frameBuffers;
+static thread_local size_t usedBuffers = 0;
+
+StackTrace::StackTrace(jthread thread) : thread(thread) {
+  if (usedBuffers == frameBuffers.size()) {
+    frameBuffers.push_back(std::make_unique<jvmtiFrameInfo[]>(MAX_FRAMES));
+  }
+  frames = frameBuffers[usedBuffers++].get();
+}
+
+StackTrace::~StackTrace() {
+  usedBuffers--;
+}
+
+void StackTrace::capture() {
+  frameCount = Jvmti::getStackTrace(thread, frames, MAX_FRAMES);
+  captured = true;
+}
+
+uint32_t StackTrace::size() {
+  if (!captured) { capture(); }
+  return frameCount;
+}
+
+std::pair<jmethodID, jlocation> StackTrace::getFrame(uint32_t depth) {
+  if (!captured) { capture(); }
+  return {frames[depth].method, frames[depth].location};
+}
@@ -0,0 +1,177 @@
+#include "bytecode/ClassFile.h"
+
+#include <fmt/fmt.h>
+
+#include "bytecode/Constants.h"
+#include "exceptions.h"
+#include "util.h"
+
+using fmt::literals::operator""_format;
+
+ClassFile::ClassFile(std::vector<uint8_t> classBytes) : bytes(std::move(classBytes)) {
+  parse();
+}
+
+ClassFile::ClassFile(ByteView classBytes) : bytes(classBytes) {
+  parse();
+}
+
+void ClassFile::parse() {
+  if (bytes.size() < 10 || ByteVectorUtil::readuint32(bytes, 0) != MAGIC) {
+    throw InvalidArgument("Not a class file");
+  }
+
+  try {
+    constPool = ConstPool::read(bytes, 10, getConstPoolCount());
+  } catch (const std::exception &e) {
+    throw InvalidArgument("Invalid constant pool: {}"_format(e.what()));
+  }
+  constPoolEnd = 10 + constPool.byteSize();
+  size_t offset = constPoolEnd;
+  if (offset + 8 > bytes.size()) {
+    throw InvalidArgument("Class file ends after constant pool");
+  }
+
+  accessFlags = ByteVectorUtil::readuint16(bytes, offset);
+  thisClass = ByteVectorUtil::readuint16(bytes, offset + 2);
+  superClass = ByteVectorUtil::readuint16(bytes, offset + 4);
+  uint16_t interfacesCount = ByteVectorUtil::readuint16(bytes, offset + 6);
+  offset += 8;
+  requireBytes(offset, 2 * static_cast<size_t>(interfacesCount), "Interfaces");
+  offset += 2 * static_cast<size_t>(interfacesCount);
+
+  fields = readMembers(offset);
+  methods = readMembers(offset);
+  attributes = readAttributes(offset);
+
+  if (offset != bytes.size()) {
+    throw InvalidArgument("Class file has {} trailing bytes"_format(bytes.size() - offset));
+  }
+}
+
+void ClassFile::requireBytes(size_t offset, size_t count, const char *what) const {
+  if (offset > bytes.size() || count > bytes.size() - offset) {
+    throw InvalidArgument("{} at offset {} exceeds class file length"_format(what, offset));
+  }
+}
+
+std::vector<MemberInfo> ClassFile::readMembers(size_t &offset) const {
+  requireBytes(offset, 2, "Member count");
+  uint16_t count = ByteVectorUtil::readuint16(bytes, offset);
+  offset += 2;
+
+  std::vector<MemberInfo> members;
+  members.reserve(count);
+  for (uint16_t i = 0; i < count; i++) {
+    requireBytes(offset, 6, "Member");
+    MemberInfo member{};
+    member.accessFlags = ByteVectorUtil::readuint16(bytes, offset);
+    member.nameIndex = ByteVectorUtil::readuint16(bytes, offset + 2);
+    member.descriptorIndex = ByteVectorUtil::readuint16(bytes, offset + 4);
+    offset += 6;
+    member.attributes = readAttributes(offset);
+    members.push_back(std::move(member));
+  }
+  return members;
+}
+
+std::vector<AttributeInfo> ClassFile::readAttributes(size_t &offset) const {
+  requireBytes(offset, 2, "Attribute count");
+  uint16_t count = ByteVectorUtil::readuint16(bytes, offset);
+  offset += 2;
+
+  std::vector<AttributeInfo> attributeInfos;
+  attributeInfos.reserve(count);
+  for (uint16_t i = 0; i < count; i++) {
+    requireBytes(offset, 6, "Attribute");
+    AttributeInfo attribute{};
+    attribute.nameIndex = ByteVectorUtil::readuint16(bytes, offset);
+    attribute.offset = offset;
+    attribute.length = ByteVectorUtil::readuint32(bytes, offset + 2);
+    requireBytes(offset + 6, attribute.length, "Attribute");
+    offset += 6 + static_cast<size_t>(attribute.length);
+    attributeInfos.push_back(attribute);
+  }
+  return attributeInfos;
+}
+
+uint16_t ClassFile::getConstPoolCount() const {
+  return ByteVectorUtil::readuint16(bytes, 8);
+}
+
+uint16_t ClassFile::getMajorVersion() const {
+  return ByteVectorUtil::readuint16(bytes, 6);
+}
+
+const MemberInfo *ClassFile::findMethod(std::string_view name, std::string_view descriptor) const {
+  for (const MemberInfo &method : methods) {
+    if (constPool.getUtf8(method.nameIndex) == name && constPool.getUtf8(method.descriptorIndex) == descriptor) {
+      return &method;
+    }
+  }
+  return nullptr;
+}
+
+const AttributeInfo *ClassFile::findAttribute(const std::vector<AttributeInfo> &attributeInfos, std::string_view name) const {
+  for (const AttributeInfo &attribute : attributeInfos) {
+    if (constPool.getUtf8(attribute.nameIndex) == name) {
+      return &attribute;
+    }
+  }
+  return nullptr;
+}
+
+CodeInfo ClassFile::readCode(const AttributeInfo &codeAttribute) const {
+  // Attributes were checked to be in the class file, everything read here must also stay in the attribute
+  size_t end = codeAttribute.offset + 6 + codeAttribute.length;
+  // max_stack, max_locals, code_length, exception_table_length, attributes_count
+  if (codeAttribute.length < 2 + 2 + 4 + 2 + 2) {
+    throw InvalidArgument("Code attribute at offset {} is too short"_format(codeAttribute.offset));
+  }
+
+  size_t offset = codeAttribute.offset + 6 + 2 + 2;
+  CodeInfo code{};
+  code.codeLength = ByteVectorUtil::readuint32(bytes, offset);
+  code.codeOffset = offset + 4;
+  if (code.codeLength > end - code.codeOffset - 4) {
+    throw InvalidArgument("Code at offset {} exceeds its attribute"_format(code.codeOffset));
+  }
+
+  offset = code.codeOffset + code.codeLength;
+  uint16_t exceptionTableLength = ByteVectorUtil::readuint16(bytes, offset);
+  offset += 2;
+  if (8 * static_cast<size_t>(exceptionTableLength) > end - offset - 2) {
+    throw InvalidArgument("Exception table at offset {} exceeds its attribute"_format(offset - 2));
+  }
+  // start_pc, end_pc, handler_pc, catch_type
+  code.handlerPcs.reserve(exceptionTableLength);
+  for (uint16_t entry = 0; entry < exceptionTableLength; entry++) {
+    code.handlerPcs.push_back(ByteVectorUtil::readuint16(bytes, offset + 4));
+    offset += 8;
+  }
+  code.attributes = readAttributes(offset);
+
+  if (offset != codeAttribute.offset + 6 + codeAttribute.length) {
+    throw InvalidArgument("Code attribute at offset {} has inconsistent length"_format(codeAttribute.offset));
+  }
+  return code;
+}
+
+LocalVariableTable ClassFile::readLocalVariableTable(const AttributeInfo &localVariableTable) const {
+  if (localVariableTable.length < 2) {
+    throw InvalidArgument("LocalVariableTable at offset {} is too short"_format(localVariableTable.offset));
+  }
+  uint16_t count = ByteVectorUtil::readuint16(bytes, localVariableTable.offset + 6);
+  if (2 + 10 * static_cast<size_t>(count) > localVariableTable.length) {
+    throw InvalidArgument("LocalVariableTable at offset {} has inconsistent length"_format(localVariableTable.offset));
+  }
+
+  LocalVariableTable variables;
+  // start_pc, length, name_index, descriptor_index, index
+  for (size_t entry = localVariableTable.offset + 8; entry < localVariableTable.offset + 8 + 10 * count; entry += 10) {
+    variables.addEntry(static_cast<uint8_t>(ByteVectorUtil::readuint16(bytes, entry + 8)),
+                       constPool.getUtf8(ByteVectorUtil::readuint16(bytes, entry + 4)),
+                       constPool.getUtf8(ByteVectorUtil::readuint16(bytes, entry + 6)));
+  }
+  return variables;
+}
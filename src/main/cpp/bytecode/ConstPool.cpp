@@ -1,6 +1,5 @@
 #include "bytecode/ConstPool.h"
 
-#include <fstream>
 #include <spdlog.h>
 
 #include "bytecode/Constants.h"
@@ -10,289 +9,252 @@ using fmt::literals::operator""_format;
 
 static auto logger = getLogger("Bytecode");
 
-// ****************************************
-// ******      Print Visitors       *******
-// ****************************************
-
-void ConstInfoPadding::visit(const ConstPool &constPool, std::function<void(const std::string &)> visitor, bool firstLevel) const {
-  visitor("padding");
-}
-
-void UTF8Info::visit(const ConstPool &constPool, std::function<void(const std::string &)> visitor, bool firstLevel) const {
-  if (firstLevel) {
-    visitor(std::string(Constants::CpInfoMnemonic[tag]) + " ");
-  }
-  visitor(string);
-}
-
-void IntegerInfo::visit(const ConstPool &constPool, std::function<void(const std::string &)> visitor, bool firstLevel) const {
-  if (firstLevel) {
-    visitor(std::string(Constants::CpInfoMnemonic[tag]) + " ");
-  }
-  visitor(std::to_string(value));
-}
-
-void FloatInfo::visit(const ConstPool &constPool, std::function<void(const std::string &)> visitor, bool firstLevel) const {
-  if (firstLevel) {
-    visitor(std::string(Constants::CpInfoMnemonic[tag]) + " ");
-  }
-  visitor(std::to_string(value));
-}
-
-void LongInfo::visit(const ConstPool &constPool, std::function<void(const std::string &)> visitor, bool firstLevel) const {
-  if (firstLevel) {
-    visitor(std::string(Constants::CpInfoMnemonic[tag]) + " ");
-  }
-  visitor(std::to_string(value));
-}
-
-void DoubleInfo::visit(const ConstPool &constPool, std::function<void(const std::string &)> visitor, bool firstLevel) const {
-  if (firstLevel) {
-    visitor(std::string(Constants::CpInfoMnemonic[tag]) + " ");
-  }
-  visitor(std::to_string(value));
-}
-
-void ClassInfo::visit(const ConstPool &constPool, std::function<void(const std::string &)> visitor, bool firstLevel) const {
-  if (firstLevel) {
-    visitor(std::string(Constants::CpInfoMnemonic[tag]) + " ");
-  }
-  constPool.get(nameIndex).visit(constPool, visitor, false);
-}
-
-void StringInfo::visit(const ConstPool &constPool, std::function<void(const std::string &)> visitor, bool firstLevel) const {
-  if (firstLevel) {
-    visitor(std::string(Constants::CpInfoMnemonic[tag]) + " ");
-  }
-  constPool.get(stringIndex).visit(constPool, visitor, false);
-}
-
-void MemberRefInfo::visit(const ConstPool &constPool, std::function<void(const std::string &)> visitor, bool firstLevel) const {
-  if (firstLevel) {
-    visitor(std::string(Constants::CpInfoMnemonic[getTag()]) + " ");
-  }
-  constPool.get(classIndex).visit(constPool, visitor, false);
-  visitor(".");
-  constPool.get(nameAndTypeIndex).visit(constPool, visitor, false);
-}
-
-void NameAndTypeInfo::visit(const ConstPool &constPool, std::function<void(const std::string &)> visitor, bool firstLevel) const {
-  if (firstLevel) {
-    visitor(std::string(Constants::CpInfoMnemonic[tag]) + " ");
-  }
-  constPool.get(nameIndex).visit(constPool, visitor, false);
-  visitor(":");
-  constPool.get(descriptorIndex).visit(constPool, visitor, false);
-}
-
-void MethodHandleInfo::visit(const ConstPool &constPool, std::function<void(const std::string &)> visitor, bool firstLevel) const {
-  if (firstLevel) {
-    visitor(std::string(Constants::CpInfoMnemonic[tag]) + " ");
-  }
-  visitor(std::string(Constants::ReferenceKindMnemonic[referenceKind]) + " ");
-  constPool.get(referenceIndex).visit(constPool, visitor, false);
-}
-
-void MethodTypeInfo::visit(const ConstPool &constPool, std::function<void(const std::string &)> visitor, bool firstLevel) const {
-  if (firstLevel) {
-    visitor(std::string(Constants::CpInfoMnemonic[tag]) + " ");
-  }
-  constPool.get(descriptorIndex).visit(constPool, visitor, false);
-}
-
-void InvokeDynamicInfo::visit(const ConstPool &constPool, std::function<void(const std::string &)> visitor, bool firstLevel) const {
-  if (firstLevel) {
-    visitor(std::string(Constants::CpInfoMnemonic[tag]) + " ");
-  }
-  visitor(std::to_string(bootstrapMethodAttrIndex) + " ");
-  constPool.get(nameAndTypeIndex).visit(constPool, visitor, false);
-}
-
-// ****************************************
-// ******       Deserializers       *******
-// ****************************************
-
-std::unique_ptr<ConstInfo> ConstInfo::read(const std::vector<uint8_t> &constPoolBytes, size_t &offset, size_t index) {
-  uint8_t tag = constPoolBytes[offset];
-  offset++;
+size_t ConstPool::entryLength(ByteView constPoolBytes, size_t offset) {
+  uint8_t tag = constPoolBytes.at(offset);
   switch (tag) {
     case CpInfo::Utf8:
-      return UTF8Info::read(constPoolBytes, offset, index);
+      if (offset + 3 > constPoolBytes.size()) {
+        throw std::runtime_error("Utf8 entry at offset {} exceeds the constant pool"_format(offset));
+      }
+      return 3 + ByteVectorUtil::readuint16(constPoolBytes, offset + 1);
     case CpInfo::Integer:
-      return IntegerInfo::read(constPoolBytes, offset, index);
     case CpInfo::Float:
-      return FloatInfo::read(constPoolBytes, offset, index);
-    case CpInfo::Long:
-      return LongInfo::read(constPoolBytes, offset, index);
-    case CpInfo::Double:
-      return DoubleInfo::read(constPoolBytes, offset, index);
-    case CpInfo::Class:
-      return ClassInfo::read(constPoolBytes, offset, index);
-    case CpInfo::String:
-      return StringInfo::read(constPoolBytes, offset, index);
     case CpInfo::Fieldref:
-      return FieldRefInfo::read(constPoolBytes, offset, index);
     case CpInfo::Methodref:
-      return MethodRefInfo::read(constPoolBytes, offset, index);
     case CpInfo::InterfaceMethodref:
-      return InterfaceMethodRefInfo::read(constPoolBytes, offset, index);
     case CpInfo::NameAndType:
-      return NameAndTypeInfo::read(constPoolBytes, offset, index);
-    case CpInfo::MethodHandle:
-      return MethodHandleInfo::read(constPoolBytes, offset, index);
-    case CpInfo::MethodType:
-      return MethodTypeInfo::read(constPoolBytes, offset, index);
+    case CpInfo::Dynamic:
     case CpInfo::InvokeDynamic:
-      return InvokeDynamicInfo::read(constPoolBytes, offset, index);
+      return 5;
+    case CpInfo::Long:
+    case CpInfo::Double:
+      return 9;
+    case CpInfo::Class:
+    case CpInfo::String:
+    case CpInfo::MethodType:
+    case CpInfo::Module:
+    case CpInfo::Package:
+      return 3;
+    case CpInfo::MethodHandle:
+      return 4;
     default:
       throw std::runtime_error("Unexpected tag {} at offset {}"_format(tag, offset));
   }
 }
 
-std::unique_ptr<ConstInfo> UTF8Info::read(const std::vector<uint8_t> &constPoolBytes, size_t &offset, size_t index) {
-  uint16_t utflen = ByteVectorUtil::readuint16(constPoolBytes, offset);
-  offset += 2;
-
-  std::string utf8String((const char *) &constPoolBytes[offset], utflen);
-  offset += utflen;
-
-  return std::make_unique<UTF8Info>(utf8String, index);
+ConstPool::ConstPool(std::vector<uint8_t> constPoolBytes) : bytes(std::move(constPoolBytes)), offsets{NO_ENTRY} {
+  offsets.reserve(bytes.size() / 4);
+  if (index(SIZE_MAX) != bytes.size()) {
+    throw std::runtime_error("Constant pool entry exceeds {} bytes"_format(bytes.size()));
+  }
 }
 
-std::unique_ptr<ConstInfo> IntegerInfo::read(const std::vector<uint8_t> &constPoolBytes, size_t &offset, size_t index) {
-  int32_t value = ByteVectorUtil::readint32(constPoolBytes, offset);
-  offset += 4;
-
-  return std::make_unique<IntegerInfo>(value, index);
+ConstPool::ConstPool(ByteView constPoolBytes) : bytes(constPoolBytes), offsets{NO_ENTRY} {
+  offsets.reserve(bytes.size() / 4);
+  if (index(SIZE_MAX) != bytes.size()) {
+    throw std::runtime_error("Constant pool entry exceeds {} bytes"_format(bytes.size()));
+  }
 }
 
-std::unique_ptr<ConstInfo> FloatInfo::read(const std::vector<uint8_t> &constPoolBytes, size_t &offset, size_t index) {
-  float value = ByteVectorUtil::readfloat(constPoolBytes, offset);
-  offset += 4;
+ConstPool ConstPool::read(ByteView classBytes, size_t offset, uint16_t count) {
+  if (count == 0) {
+    throw std::runtime_error("Invalid constant pool count 0");
+  }
 
-  return std::make_unique<FloatInfo>(value, index);
+  // Entries are read from the rest of the class file, the view is cut at the end of the last one
+  ConstPool constPool;
+  constPool.bytes = ByteBuffer(classBytes.subview(offset, classBytes.size() - offset));
+  constPool.offsets.reserve(count);
+  size_t end = constPool.index(count);
+  if (constPool.offsets.size() != count) {
+    throw std::runtime_error("Constant pool has {} of {} entries"_format(constPool.offsets.size(), count));
+  }
+  constPool.bytes = ByteBuffer(classBytes.subview(offset, end));
+  return constPool;
 }
 
-std::unique_ptr<ConstInfo> LongInfo::read(const std::vector<uint8_t> &constPoolBytes, size_t &offset, size_t index) {
-  long value = ByteVectorUtil::readint64(constPoolBytes, offset);
-  offset += 8;
-
-  return std::make_unique<LongInfo>(value, index);
+size_t ConstPool::index(size_t count) {
+  size_t readPos = 0;
+  while (offsets.size() < count && readPos < bytes.size()) {
+    uint8_t tag = bytes[readPos];
+    offsets.push_back(static_cast<uint32_t>(readPos));
+    readPos += entryLength(bytes, readPos);
+    if (tag == CpInfo::Long || tag == CpInfo::Double) {
+      offsets.push_back(NO_ENTRY);
+    }
+  }
+  return readPos;
 }
 
-std::unique_ptr<ConstInfo> DoubleInfo::read(const std::vector<uint8_t> &constPoolBytes, size_t &offset, size_t index) {
-  double value = ByteVectorUtil::readdouble(constPoolBytes, offset);
-  offset += 8;
+// ****************************************
+// ******         Accessors         *******
+// ****************************************
 
-  return std::make_unique<DoubleInfo>(value, index);
+uint8_t ConstPool::getTag(size_t index) const {
+  uint32_t offset = offsets.at(index);
+  return offset == NO_ENTRY ? 0 : bytes[offset];
 }
 
-std::unique_ptr<ConstInfo> ClassInfo::read(const std::vector<uint8_t> &constPoolBytes, size_t &offset, size_t index) {
-  uint16_t nameIndex = ByteVectorUtil::readuint16(constPoolBytes, offset);
-  offset += 2;
-
-  return std::make_unique<ClassInfo>(nameIndex, index);
+size_t ConstPool::entryOffset(size_t index, uint8_t expectedTag) const {
+  uint8_t tag = getTag(index);
+  if (tag != expectedTag) {
+    throw std::runtime_error("Constant pool entry #{} is {}, expected {}"_format(
+        index, Constants::CpInfoMnemonic[tag], Constants::CpInfoMnemonic[expectedTag]));
+  }
+  return offsets[index] + 1;
 }
 
-std::unique_ptr<ConstInfo> StringInfo::read(const std::vector<uint8_t> &constPoolBytes, size_t &offset, size_t index) {
-  uint16_t stringIndex = ByteVectorUtil::readuint16(constPoolBytes, offset);
-  offset += 2;
-
-  return std::make_unique<StringInfo>(stringIndex, index);
+std::string_view ConstPool::getUtf8(size_t index) const {
+  size_t offset = entryOffset(index, CpInfo::Utf8);
+  uint16_t length = ByteVectorUtil::readuint16(bytes, offset);
+  return std::string_view(reinterpret_cast<const char *>(bytes.data() + offset + 2), length);
 }
 
-std::unique_ptr<ConstInfo> FieldRefInfo::read(const std::vector<uint8_t> &constPoolBytes, size_t &offset, size_t index) {
-  uint16_t classIndex = ByteVectorUtil::readuint16(constPoolBytes, offset);
-  uint16_t nameAndTypeIndex = ByteVectorUtil::readuint16(constPoolBytes, offset + 2);
-  offset += 4;
-
-  return std::make_unique<FieldRefInfo>(classIndex, nameAndTypeIndex, index);
+int32_t ConstPool::getInteger(size_t index) const {
+  return ByteVectorUtil::readint32(bytes, entryOffset(index, CpInfo::Integer));
 }
 
-std::unique_ptr<ConstInfo> MethodRefInfo::read(const std::vector<uint8_t> &constPoolBytes, size_t &offset, size_t index) {
-  uint16_t classIndex = ByteVectorUtil::readuint16(constPoolBytes, offset);
-  uint16_t nameAndTypeIndex = ByteVectorUtil::readuint16(constPoolBytes, offset + 2);
-  offset += 4;
-
-  return std::make_unique<MethodRefInfo>(classIndex, nameAndTypeIndex, index);
+float ConstPool::getFloat(size_t index) const {
+  return ByteVectorUtil::readfloat(bytes, entryOffset(index, CpInfo::Float));
 }
 
-std::unique_ptr<ConstInfo> InterfaceMethodRefInfo::read(const std::vector<uint8_t> &constPoolBytes, size_t &offset, size_t index) {
-  uint16_t classIndex = ByteVectorUtil::readuint16(constPoolBytes, offset);
-  uint16_t nameAndTypeIndex = ByteVectorUtil::readuint16(constPoolBytes, offset + 2);
-  offset += 4;
-
-  return std::make_unique<InterfaceMethodRefInfo>(classIndex, nameAndTypeIndex, index);
+int64_t ConstPool::getLong(size_t index) const {
+  return ByteVectorUtil::readint64(bytes, entryOffset(index, CpInfo::Long));
 }
 
-std::unique_ptr<ConstInfo> NameAndTypeInfo::read(const std::vector<uint8_t> &constPoolBytes, size_t &offset, size_t index) {
-  uint16_t nameIndex = ByteVectorUtil::readuint16(constPoolBytes, offset);
-  uint16_t descriptorIndex = ByteVectorUtil::readuint16(constPoolBytes, offset + 2);
-  offset += 4;
-
-  return std::make_unique<NameAndTypeInfo>(nameIndex, descriptorIndex, index);
+double ConstPool::getDouble(size_t index) const {
+  return ByteVectorUtil::readdouble(bytes, entryOffset(index, CpInfo::Double));
 }
 
-std::unique_ptr<ConstInfo> MethodHandleInfo::read(const std::vector<uint8_t> &constPoolBytes, size_t &offset, size_t index) {
-  uint8_t referenceKind = constPoolBytes[offset];
-  uint16_t referenceIndex = ByteVectorUtil::readuint16(constPoolBytes, offset + 1);
-  offset += 3;
-
-  return std::make_unique<MethodHandleInfo>(referenceKind, referenceIndex, index);
+std::string_view ConstPool::getClassName(size_t index) const {
+  return getUtf8(ByteVectorUtil::readuint16(bytes, entryOffset(index, CpInfo::Class)));
 }
 
-std::unique_ptr<ConstInfo> MethodTypeInfo::read(const std::vector<uint8_t> &constPoolBytes, size_t &offset, size_t index) {
-  uint16_t descriptorIndex = ByteVectorUtil::readuint16(constPoolBytes, offset);
-  offset += 2;
-
-  return std::make_unique<MethodTypeInfo>(descriptorIndex, index);
+std::string_view ConstPool::getString(size_t index) const {
+  return getUtf8(ByteVectorUtil::readuint16(bytes, entryOffset(index, CpInfo::String)));
 }
 
-std::unique_ptr<ConstInfo> InvokeDynamicInfo::read(const std::vector<uint8_t> &constPoolBytes, size_t &offset, size_t index) {
-  uint16_t bootstrapMethodAttrIndex = ByteVectorUtil::readuint16(constPoolBytes, offset);
-  uint16_t nameAndTypeIndex = ByteVectorUtil::readuint16(constPoolBytes, offset + 2);
-  offset += 4;
-
-  return std::make_unique<InvokeDynamicInfo>(bootstrapMethodAttrIndex, nameAndTypeIndex, index);
+NameAndTypeRef ConstPool::getNameAndType(size_t index) const {
+  size_t offset = entryOffset(index, CpInfo::NameAndType);
+  return {getUtf8(ByteVectorUtil::readuint16(bytes, offset)), getUtf8(ByteVectorUtil::readuint16(bytes, offset + 2))};
 }
 
-void ConstPool::read(const std::vector<uint8_t> &constPoolBytes) {
-  entries.reserve(constPoolBytes.size() / 4);
-  size_t readPos = 0;
-  while (readPos < constPoolBytes.size()) {
-    std::unique_ptr<ConstInfo> constPoolEntry = ConstInfo::read(constPoolBytes, readPos, indexPos);
-    uint8_t tag = constPoolEntry->getTag();
-//    log.debug(formatString("#%d\t%d=%s", indexPos, constPoolEntry->getTag(), Constants::CpInfoMnemonic[constPoolEntry->getTag()]));
-//    log.debug(formatString("Readpos: %d / %d", readPos, constPoolBytes.size()));
-    entries.push_back(std::move(constPoolEntry));
-    indexPos++;
-    if (tag == CpInfo::Long || tag == CpInfo::Double) {
-      entries.push_back(std::make_unique<ConstInfoPadding>(indexPos));
-      indexPos++;
-    }
+MemberRef ConstPool::getMemberRef(size_t index) const {
+  uint8_t tag = getTag(index);
+  if (tag != CpInfo::Fieldref && tag != CpInfo::Methodref && tag != CpInfo::InterfaceMethodref) {
+    throw std::runtime_error("Constant pool entry #{} is {}, expected a member reference"_format(
+        index, Constants::CpInfoMnemonic[tag]));
   }
-}
 
-void ConstPool::read(std::ifstream classFileStream, size_t count) {
-  entries.reserve(count);
+  size_t offset = offsets[index] + 1;
+  NameAndTypeRef nameAndType = getNameAndType(ByteVectorUtil::readuint16(bytes, offset + 2));
+  return {getClassName(ByteVectorUtil::readuint16(bytes, offset)), nameAndType.name, nameAndType.descriptor};
+}
 
-  while (indexPos < count - 1) {
-    //std::unique_ptr<ConstInfo> constPoolEntry = ConstInfo::read(classFileStream, indexPos);
-  }
+NameAndTypeRef ConstPool::getInvokeDynamic(size_t index) const {
+  return getNameAndType(ByteVectorUtil::readuint16(bytes, entryOffset(index, CpInfo::InvokeDynamic) + 2));
 }
 
+// ****************************************
+// ******          Printing         *******
+// ****************************************
+
 void ConstPool::print() const {
-  for (size_t index = 0; index < entries.size(); index++) {
+  for (size_t index = 0; index < offsets.size(); index++) {
     logger->info("#{:<5}\t{}", index, entryToString(index, false));
   }
 }
 
 std::string ConstPool::entryToString(size_t index, bool identifier) const {
-  if (index >= entries.size()) {
+  if (index >= offsets.size()) {
     return "#{}"_format(index);
   }
 
   std::string entryString;
-  entries[index]->visit(*this, [&](const std::string &str) -> void { entryString += str; }, identifier);
+  appendEntry(entryString, index, identifier);
   return entryString;
 }
+
+static void appendNameAndType(std::string &out, const NameAndTypeRef &nameAndType) {
+  out += nameAndType.name;
+  out += ':';
+  out += nameAndType.descriptor;
+}
+
+static void appendMemberRef(std::string &out, const MemberRef &member) {
+  out += member.className;
+  out += '.';
+  appendNameAndType(out, NameAndTypeRef{member.name, member.descriptor});
+}
+
+/**
+ * References are resolved with the typed accessors, which throw on an entry with the wrong tag instead of following it
+ */
+void ConstPool::appendEntry(std::string &out, size_t index, bool identifier) const {
+  uint8_t tag = getTag(index);
+  if (tag == 0) {
+    out += "padding";
+    return;
+  }
+
+  if (identifier) {
+    out += Constants::CpInfoMnemonic[tag];
+    out += ' ';
+  }
+
+  size_t offset = offsets[index] + 1;
+  switch (tag) {
+    case CpInfo::Utf8:
+      out += getUtf8(index);
+      break;
+    case CpInfo::Integer:
+      out += std::to_string(getInteger(index));
+      break;
+    case CpInfo::Float:
+      out += std::to_string(getFloat(index));
+      break;
+    case CpInfo::Long:
+      out += std::to_string(getLong(index));
+      break;
+    case CpInfo::Double:
+      out += std::to_string(getDouble(index));
+      break;
+    case CpInfo::Class:
+      out += getClassName(index);
+      break;
+    case CpInfo::String:
+      out += getString(index);
+      break;
+    case CpInfo::MethodType:
+    case CpInfo::Module:
+    case CpInfo::Package:
+      out += getUtf8(ByteVectorUtil::readuint16(bytes, offset));
+      break;
+    case CpInfo::Fieldref:
+    case CpInfo::Methodref:
+    case CpInfo::InterfaceMethodref:
+      appendMemberRef(out, getMemberRef(index));
+      break;
+    case CpInfo::NameAndType:
+      appendNameAndType(out, getNameAndType(index));
+      break;
+    case CpInfo::MethodHandle: {
+      uint8_t kind = bytes[offset];
+      if (kind < 1 || kind > 9) {
+        throw std::runtime_error("Invalid reference kind {} at index {}"_format(kind, index));
+      }
+      out += Constants::ReferenceKindMnemonic[kind];
+      out += ' ';
+      appendMemberRef(out, getMemberRef(ByteVectorUtil::readuint16(bytes, offset + 1)));
+      break;
+    }
+    case CpInfo::Dynamic:
+    case CpInfo::InvokeDynamic:
+      out += std::to_string(ByteVectorUtil::readuint16(bytes, offset));
+      out += ' ';
+      appendNameAndType(out, getNameAndType(ByteVectorUtil::readuint16(bytes, offset + 2)));
+      break;
+    default:
+      throw std::runtime_error("Unexpected tag {} at index {}"_format(tag, index));
+  }
+}
@@ -0,0 +1,119 @@
+#include "bytecode/ControlFlowGraph.h"
+
+#include <algorithm>
+#include <fmt/fmt.h>
+
+#include "exceptions.h"
+#include "util.h"
+
+using fmt::literals::operator""_format;
+
+ControlFlowGraph::ControlFlowGraph(const CodeAttribute &code, const std::vector<uint16_t> *handlerPcs) {
+  const std::vector<uint16_t> &instructions = code.getInstructions();
+  std::vector<bool> leaders(code.getSize() + 1, false);
+  leaders[0] = true;
+
+  if (handlerPcs != nullptr) {
+    for (uint16_t handlerPc : *handlerPcs) {
+      if (handlerPc >= code.getSize() || !code.isInstructionStart(handlerPc)) {
+        throw InvalidArgument("Exception handler {} is not an instruction"_format(handlerPc));
+      }
+      leaders[handlerPc] = true;
+    }
+  }
+
+  for (size_t offset : instructions) {
+    uint8_t opCode = code.getOpcode(offset);
+    std::vector<size_t> targets = getJumpTargets(code, offset);
+    for (size_t target : targets) {
+      leaders[target] = true;
+    }
+    if (!targets.empty() || !fallsThrough(opCode)) {
+      leaders[offset + code.getInstructionLength(offset)] = true;
+    }
+  }
+
+  for (size_t i = 0; i < instructions.size(); i++) {
+    size_t offset = instructions[i];
+    if (leaders[offset]) {
+      blocks.push_back(BasicBlock{offset, offset, {}});
+    }
+    blocks.back().end = offset + code.getInstructionLength(offset);
+  }
+
+  for (size_t index = 0; index < blocks.size(); index++) {
+    BasicBlock &block = blocks[index];
+    size_t last = *(std::upper_bound(instructions.begin(), instructions.end(), block.end - 1) - 1);
+    uint8_t opCode = code.getOpcode(last);
+
+    for (size_t target : getJumpTargets(code, last)) {
+      block.successors.push_back(getBlockIndex(target));
+    }
+    if (fallsThrough(opCode) && index + 1 < blocks.size()) {
+      block.successors.push_back(index + 1);
+    }
+  }
+}
+
+size_t ControlFlowGraph::getBlockIndex(size_t offset) const {
+  auto it = std::upper_bound(blocks.begin(), blocks.end(), offset,
+                             [](size_t off, const BasicBlock &block) { return off < block.start; });
+  if (it == blocks.begin() || offset >= (it - 1)->end) {
+    throw InvalidArgument("Offset {} is not in any basic block"_format(offset));
+  }
+  return static_cast<size_t>(it - blocks.begin() - 1);
+}
+
+std::vector<size_t> ControlFlowGraph::getJumpTargets(const CodeAttribute &code, size_t offset) {
+  ByteView bytes = code.getCode();
+  uint8_t opCode = code.getOpcode(offset);
+  std::vector<size_t> targets;
+
+  if (opCode >= OpCodes::IFEQ && opCode <= OpCodes::JSR || opCode == OpCodes::IFNULL || opCode == OpCodes::IFNONNULL) {
+    targets.push_back(offset + ByteVectorUtil::readint16(bytes, offset + 1));
+  } else if (opCode == OpCodes::GOTO_W || opCode == OpCodes::JSR_W) {
+    targets.push_back(offset + ByteVectorUtil::readint32(bytes, offset + 1));
+  } else if (opCode == OpCodes::TABLESWITCH) {
+    size_t pos = offset + 1 + (3 - offset % 4);
+    targets.push_back(offset + ByteVectorUtil::readint32(bytes, pos));
+    int32_t low = ByteVectorUtil::readint32(bytes, pos + 4);
+    int32_t high = ByteVectorUtil::readint32(bytes, pos + 8);
+    for (int64_t i = 0; i <= int64_t(high) - low; i++) {
+      targets.push_back(offset + ByteVectorUtil::readint32(bytes, pos + 12 + i * 4));
+    }
+  } else if (opCode == OpCodes::LOOKUPSWITCH) {
+    size_t pos = offset + 1 + (3 - offset % 4);
+    targets.push_back(offset + ByteVectorUtil::readint32(bytes, pos));
+    int32_t npairs = ByteVectorUtil::readint32(bytes, pos + 4);
+    for (int32_t i = 0; i < npairs; i++) {
+      targets.push_back(offset + ByteVectorUtil::readint32(bytes, pos + 8 + i * 8 + 4));
+    }
+  }
+
+  for (size_t target : targets) {
+    if (target >= code.getSize()) {
+      throw InvalidArgument("Jump target {} of instruction at {} is outside of code"_format(target, offset));
+    }
+  }
+  return targets;
+}
+
+bool ControlFlowGraph::fallsThrough(uint8_t opCode) {
+  switch (opCode) {
+    case OpCodes::GOTO:
+    case OpCodes::GOTO_W:
+    case OpCodes::RET:
+    case OpCodes::TABLESWITCH:
+    case OpCodes::LOOKUPSWITCH:
+    case OpCodes::IRETURN:
+    case OpCodes::LRETURN:
+    case OpCodes::FRETURN:
+    case OpCodes::DRETURN:
+    case OpCodes::ARETURN:
+    case OpCodes::RETURN:
+    case OpCodes::ATHROW:
+      return false;
+    default:
+      return true;
+  }
+}
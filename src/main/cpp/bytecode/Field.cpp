@@ -13,12 +13,7 @@ Field Field::readFromFieldInsn(const CodeAttribute &code, const ConstPool &const
 }
 
 Field Field::readFromMemberRef(const ConstPool &constPool, size_t refId) {
-  const auto &memberRef = dynamic_cast<const MemberRefInfo &> (constPool.get(refId));
-  const auto &nameAndTypeRef = dynamic_cast<const NameAndTypeInfo &>(constPool.get(memberRef.getNameAndTypeIndex()));
-
-  std::string className = toJavaClassName(constPool.entryToString(memberRef.getClassIndex(), false));
-  std::string fieldName = constPool.entryToString(nameAndTypeRef.getNameIndex(), false);
-  std::string typeName = toJavaTypeName(constPool.entryToString(nameAndTypeRef.getDescriptorIndex(), false));
-
-  return Field(className, fieldName, typeName);
+  MemberRef memberRef = constPool.getMemberRef(refId);
+  return Field(Symbols::className(memberRef.className).javaName, Symbols::intern(memberRef.name),
+               Symbols::fieldType(memberRef.descriptor));
 }
\ No newline at end of file
@@ -12,3 +12,13 @@ std::optional<const std::tuple<std::string_view, std::string_view>> LocalVariabl
 void LocalVariableTable::addEntry(uint8_t slot, std::string_view name, std::string_view signature) {
   table.emplace(slot, std::make_pair(name, signature));
 }
+
+uint64_t LocalVariableTable::hash(uint64_t hash) const {
+  for (const auto &[slot, entry] : table) {
+    const auto &[name, signature] = entry;
+    hash = ByteVectorUtil::hash(ByteView(&slot, 1), hash);
+    hash = ByteVectorUtil::hash(ByteView(reinterpret_cast<const uint8_t *>(name.data()), name.size()), hash);
+    hash = ByteVectorUtil::hash(ByteView(reinterpret_cast<const uint8_t *>(signature.data()), signature.size()), hash);
+  }
+  return hash;
+}
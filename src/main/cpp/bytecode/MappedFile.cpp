@@ -0,0 +1,99 @@
+#include "bytecode/MappedFile.h"
+
+#include <stdexcept>
+#include <fmt/fmt.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using fmt::literals::operator""_format;
+
+#ifdef _WIN32
+
+MappedFile::MappedFile(const std::string &path) {
+  fileHandle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                           FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (fileHandle == INVALID_HANDLE_VALUE) {
+    fileHandle = nullptr;
+    throw std::runtime_error("Failed to open {}: error {}"_format(path, GetLastError()));
+  }
+
+  LARGE_INTEGER fileSize;
+  if (!GetFileSizeEx(fileHandle, &fileSize)) {
+    DWORD error = GetLastError();
+    unmap();
+    throw std::runtime_error("Failed to get size of {}: error {}"_format(path, error));
+  }
+  length = static_cast<size_t>(fileSize.QuadPart);
+  // Empty files can't be mapped, an empty view is all there is to read
+  if (length == 0) { return; }
+
+  mappingHandle = CreateFileMappingA(fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  if (mappingHandle != nullptr) {
+    bytes = static_cast<const uint8_t *>(MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0));
+  }
+  if (bytes == nullptr) {
+    DWORD error = GetLastError();
+    unmap();
+    throw std::runtime_error("Failed to map {}: error {}"_format(path, error));
+  }
+}
+
+void MappedFile::unmap() {
+  if (bytes != nullptr) { UnmapViewOfFile(bytes); }
+  if (mappingHandle != nullptr) { CloseHandle(mappingHandle); }
+  if (fileHandle != nullptr) { CloseHandle(fileHandle); }
+  bytes = nullptr;
+  mappingHandle = nullptr;
+  fileHandle = nullptr;
+}
+
+#else
+
+MappedFile::MappedFile(const std::string &path) {
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    throw std::runtime_error("Failed to open {}: {}"_format(path, std::strerror(errno)));
+  }
+
+  struct stat status{};
+  if (fstat(fd, &status) != 0) {
+    int error = errno;
+    close(fd);
+    throw std::runtime_error("Failed to get size of {}: {}"_format(path, std::strerror(error)));
+  }
+  length = static_cast<size_t>(status.st_size);
+  // Empty files can't be mapped, an empty view is all there is to read
+  if (length == 0) {
+    close(fd);
+    return;
+  }
+
+  void *mapped = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+  int error = errno;
+  // The mapping keeps its own reference to the file
+  close(fd);
+  if (mapped == MAP_FAILED) {
+    throw std::runtime_error("Failed to map {}: {}"_format(path, std::strerror(error)));
+  }
+  bytes = static_cast<const uint8_t *>(mapped);
+}
+
+void MappedFile::unmap() {
+  if (bytes != nullptr) { munmap(const_cast<uint8_t *>(bytes), length); }
+  bytes = nullptr;
+}
+
+#endif
+
+MappedFile::~MappedFile() {
+  unmap();
+}
@@ -0,0 +1,261 @@
+#include "bytecode/StackAnalysis.h"
+
+#include <algorithm>
+#include <deque>
+#include <fmt/fmt.h>
+
+#include "bytecode/Field.h"
+#include "bytecode/Method.h"
+#include "bytecode/Symbols.h"
+#include "exceptions.h"
+#include "util.h"
+
+using fmt::literals::operator""_format;
+
+StackAnalysis::StackAnalysis(const CodeAttribute &code, const ConstPool &constPool,
+                             const std::vector<uint16_t> *handlerPcs) : code(code), constPool(constPool) {
+  auto result = std::make_shared<Flow>(Flow{ControlFlowGraph(code, handlerPcs), {}});
+  result->entryStacks.resize(result->cfg.getBlocks().size());
+  analyze(*result, handlerPcs);
+  flow = std::move(result);
+}
+
+StackAnalysis::StackAnalysis(const CodeAttribute &code, const ConstPool &constPool, std::shared_ptr<const Flow> flow) :
+    code(code), constPool(constPool), flow(std::move(flow)) {
+}
+
+void StackAnalysis::analyze(Flow &result, const std::vector<uint16_t> *handlerPcs) const {
+  const std::vector<BasicBlock> &blocks = result.cfg.getBlocks();
+  std::vector<std::optional<std::vector<uint32_t>>> &entryStacks = result.entryStacks;
+  if (blocks.empty()) { return; }
+
+  std::deque<size_t> worklist;
+  std::vector<bool> queued(blocks.size(), false);
+  entryStacks[0] = std::vector<uint32_t>();
+  worklist.push_back(0);
+  queued[0] = true;
+
+  if (handlerPcs != nullptr) {
+    for (uint16_t handlerPc : *handlerPcs) {
+      size_t index = result.cfg.getBlockIndex(handlerPc);
+      if (!entryStacks[index].has_value()) { entryStacks[index] = std::vector<uint32_t>{CAUGHT_EXCEPTION}; }
+      if (!queued[index]) {
+        worklist.push_back(index);
+        queued[index] = true;
+      }
+    }
+  }
+
+  size_t nextUnreached = 0;
+  while (true) {
+    while (!worklist.empty()) {
+      size_t index = worklist.front();
+      worklist.pop_front();
+      queued[index] = false;
+
+      const BasicBlock &block = blocks[index];
+      std::vector<uint32_t> stack = *entryStacks[index];
+      size_t last = block.start;
+      for (size_t offset = block.start; offset < block.end; offset += code.getInstructionLength(offset)) {
+        execute(code, constPool, offset, stack);
+        last = offset;
+      }
+
+      uint8_t lastOpCode = code.getOpcode(last);
+      for (size_t successor : block.successors) {
+        // Return address of jsr is only on the stack of the subroutine, not when execution continues after ret
+        bool afterJsr = (lastOpCode == OpCodes::JSR || lastOpCode == OpCodes::JSR_W) && successor == index + 1 &&
+                        blocks[successor].start == block.end;
+        bool changed = afterJsr ? merge(result, successor, std::vector<uint32_t>(stack.begin(), stack.end() - 1))
+                                : merge(result, successor, stack);
+        if (changed && !queued[successor]) {
+          worklist.push_back(successor);
+          queued[successor] = true;
+        }
+      }
+    }
+
+    // Blocks left unreached with a known exception table are dead code
+    if (handlerPcs != nullptr) { break; }
+
+    // javac places handlers after the code they protect, the first unreached block is a handler entry
+    while (nextUnreached < blocks.size() && entryStacks[nextUnreached].has_value()) { nextUnreached++; }
+    if (nextUnreached == blocks.size()) { break; }
+
+    entryStacks[nextUnreached] = std::vector<uint32_t>{CAUGHT_EXCEPTION};
+    worklist.push_back(nextUnreached);
+    queued[nextUnreached] = true;
+  }
+}
+
+bool StackAnalysis::merge(Flow &result, size_t blockIndex, const std::vector<uint32_t> &stack) const {
+  std::optional<std::vector<uint32_t>> &entry = result.entryStacks[blockIndex];
+  if (!entry.has_value()) {
+    entry = stack;
+    return true;
+  }
+
+  if (entry->size() != stack.size()) {
+    throw InvalidArgument("Inconsistent stack height at offset {}: {} and {}"_format(
+        result.cfg.getBlocks()[blockIndex].start, entry->size(), stack.size()));
+  }
+
+  bool changed = false;
+  for (size_t i = 0; i < stack.size(); i++) {
+    if ((*entry)[i] != stack[i] && (*entry)[i] != UNKNOWN && !isSameInstruction((*entry)[i], stack[i])) {
+      (*entry)[i] = UNKNOWN;
+      changed = true;
+    }
+  }
+  return changed;
+}
+
+bool StackAnalysis::isSameInstruction(uint32_t first, uint32_t second) const {
+  if (first >= code.getSize() || second >= code.getSize()) { return false; }
+
+  size_t length = code.getInstructionLength(first);
+  ByteView bytes = code.getCode();
+  return length == code.getInstructionLength(second) &&
+         std::equal(bytes.begin() + first, bytes.begin() + first + length, bytes.begin() + second);
+}
+
+uint32_t StackAnalysis::getProducer(size_t offset, size_t depth) const {
+  size_t index = flow->cfg.getBlockIndex(offset);
+  if (!flow->entryStacks[index].has_value()) { return UNKNOWN; }
+
+  std::vector<uint32_t> stack = *flow->entryStacks[index];
+  for (size_t off = flow->cfg.getBlocks()[index].start; off < offset; off += code.getInstructionLength(off)) {
+    execute(code, constPool, off, stack);
+  }
+
+  if (depth >= stack.size()) { return UNKNOWN; }
+  return stack[stack.size() - 1 - depth];
+}
+
+uint32_t StackAnalysis::getProducerAfterFrame(const CodeAttribute &code, const ConstPool &constPool,
+                                              const StackMapFrame &frame, size_t offset, size_t depth) {
+  std::vector<uint32_t> stack(frame.stackSlots, FRAME_ENTRY);
+  size_t off = frame.offset;
+  for (; off < offset; off += code.getInstructionLength(off)) {
+    execute(code, constPool, off, stack);
+  }
+  if (off != offset) {
+    throw InvalidArgument("Offset {} is not an instruction after frame at {}"_format(offset, frame.offset));
+  }
+
+  if (depth >= stack.size()) { return UNKNOWN; }
+  return stack[stack.size() - 1 - depth];
+}
+
+void StackAnalysis::execute(const CodeAttribute &code, const ConstPool &constPool, size_t offset,
+                            std::vector<uint32_t> &stack) {
+  uint8_t opCode = code.getOpcode(offset);
+  // Wide variants of load, store, iinc and ret have the same stack effect
+  if (opCode == OpCodes::WIDE) {
+    opCode = code.getOpcode(offset + 1);
+  }
+
+  auto pop = [&](size_t count) {
+    if (stack.size() < count) {
+      throw InvalidArgument("Stack underflow at offset {} ({})"_format(offset, opcodeInfo(opCode).mnemonic));
+    }
+    stack.resize(stack.size() - count);
+  };
+  auto top = [&](size_t depth) {
+    if (stack.size() <= depth) {
+      throw InvalidArgument("Stack underflow at offset {} ({})"_format(offset, opcodeInfo(opCode).mnemonic));
+    }
+    return stack[stack.size() - 1 - depth];
+  };
+
+  switch (opCode) {
+    case OpCodes::DUP:
+      stack.push_back(top(0));
+      return;
+    case OpCodes::DUP_X1: {
+      uint32_t v1 = top(0), v2 = top(1);
+      pop(2);
+      stack.insert(stack.end(), {v1, v2, v1});
+      return;
+    }
+    case OpCodes::DUP_X2: {
+      uint32_t v1 = top(0), v2 = top(1), v3 = top(2);
+      pop(3);
+      stack.insert(stack.end(), {v1, v3, v2, v1});
+      return;
+    }
+    case OpCodes::DUP2: {
+      uint32_t v1 = top(0), v2 = top(1);
+      stack.insert(stack.end(), {v2, v1});
+      return;
+    }
+    case OpCodes::DUP2_X1: {
+      uint32_t v1 = top(0), v2 = top(1), v3 = top(2);
+      pop(3);
+      stack.insert(stack.end(), {v2, v1, v3, v2, v1});
+      return;
+    }
+    case OpCodes::DUP2_X2: {
+      uint32_t v1 = top(0), v2 = top(1), v3 = top(2), v4 = top(3);
+      pop(4);
+      stack.insert(stack.end(), {v2, v1, v4, v3, v2, v1});
+      return;
+    }
+    case OpCodes::SWAP: {
+      uint32_t v1 = top(0), v2 = top(1);
+      pop(2);
+      stack.insert(stack.end(), {v1, v2});
+      return;
+    }
+    case OpCodes::CHECKCAST:
+      // null passes any cast, keep the producer of the reference
+      top(0);
+      return;
+    default:
+      break;
+  }
+
+  const OpcodeInfo &info = opcodeInfo(opCode);
+  int pops = info.pops;
+  int pushes = info.pushes;
+  if (pops == OpcodeInfo::VARIES) {
+    std::tie(pops, pushes) = operandStackEffect(code, constPool, offset, opCode);
+  }
+
+  pop(pops);
+  stack.insert(stack.end(), pushes, static_cast<uint32_t>(offset));
+}
+
+std::pair<int, int> StackAnalysis::operandStackEffect(const CodeAttribute &code, const ConstPool &constPool,
+                                                      size_t offset, uint8_t opCode) {
+  if (opCode >= OpCodes::GETSTATIC && opCode <= OpCodes::PUTFIELD) {
+    int length = Field::readFromFieldInsn(code, constPool, offset).getTypeLength();
+    switch (opCode) {
+      case OpCodes::GETSTATIC:
+        return {0, length};
+      case OpCodes::PUTSTATIC:
+        return {length, 0};
+      case OpCodes::GETFIELD:
+        return {1, length};
+      default:
+        return {1 + length, 0};
+    }
+  }
+
+  if (opCode >= OpCodes::INVOKEVIRTUAL && opCode <= OpCodes::INVOKEINTERFACE) {
+    Method method = Method::readFromCodeInvoke(code, constPool, offset);
+    return {method.getParameterLength() + (method.isStatic() ? 0 : 1), method.getReturnLength()};
+  }
+
+  if (opCode == OpCodes::INVOKEDYNAMIC) {
+    uint16_t callSiteIndex = ByteVectorUtil::readuint16(code.getCode(), offset + 1);
+    const MethodDescriptor &descriptor = Symbols::methodDescriptor(constPool.getInvokeDynamic(callSiteIndex).descriptor);
+    return {descriptor.parameterLength, descriptor.returnLength};
+  }
+
+  if (opCode == OpCodes::MULTIANEWARRAY) {
+    return {ByteVectorUtil::readuint8(code.getCode(), offset + 3), 1};
+  }
+
+  throw InvalidArgument("Unsupported opcode for stack analysis: {}"_format(opcodeInfo(opCode).mnemonic));
+}
@@ -0,0 +1,125 @@
+#include "bytecode/StackMapTable.h"
+
+#include <algorithm>
+#include <fmt/fmt.h>
+
+#include "exceptions.h"
+#include "util.h"
+
+using fmt::literals::operator""_format;
+
+namespace VerificationType {
+  enum VerificationType {
+    Top = 0,
+    Integer = 1,
+    Float = 2,
+    Double = 3,
+    Long = 4,
+    Null = 5,
+    UninitializedThis = 6,
+    Object = 7,
+    Uninitialized = 8
+  };
+}
+
+/**
+ * Read a u2 of the table, bytes end with the table
+ */
+static uint16_t readuint16(ByteView bytes, size_t pos) {
+  if (pos + 2 > bytes.size()) {
+    throw InvalidArgument("StackMapTable ends within the entry at {}"_format(pos));
+  }
+  return ByteVectorUtil::readuint16(bytes, pos);
+}
+
+/**
+ * Skip a verification_type_info
+ * @return stack slots taken by the type
+ */
+static uint16_t readVerificationType(ByteView bytes, size_t &pos) {
+  uint8_t tag = bytes.at(pos++);
+  switch (tag) {
+    case VerificationType::Object:
+    case VerificationType::Uninitialized:
+      pos += 2;
+      return 1;
+    case VerificationType::Double:
+    case VerificationType::Long:
+      return 2;
+    default:
+      if (tag > VerificationType::Uninitialized) {
+        throw InvalidArgument("Unexpected verification type {} at {}"_format(tag, pos - 1));
+      }
+      return 1;
+  }
+}
+
+StackMapTable::StackMapTable(ByteView classBytes, size_t offset, uint32_t length) {
+  size_t end = offset + length;
+  if (end > classBytes.size()) {
+    throw InvalidArgument("StackMapTable exceeds {} bytes"_format(classBytes.size()));
+  }
+  // Reads past the table fail instead of reading the following attributes or beyond the class file
+  ByteView bytes = classBytes.subview(0, end);
+
+  uint16_t count = readuint16(bytes, offset);
+  size_t pos = offset + 2;
+  frames.reserve(count + 1);
+
+  for (uint16_t i = 0; i < count; i++) {
+    uint8_t frameType = bytes.at(pos++);
+    uint16_t offsetDelta;
+    uint16_t stackSlots = 0;
+
+    if (frameType <= 63) {
+      // same_frame
+      offsetDelta = frameType;
+    } else if (frameType <= 127) {
+      // same_locals_1_stack_item_frame
+      offsetDelta = frameType - 64;
+      stackSlots = readVerificationType(bytes, pos);
+    } else if (frameType < 247) {
+      throw InvalidArgument("Reserved frame type {}"_format(frameType));
+    } else {
+      offsetDelta = readuint16(bytes, pos);
+      pos += 2;
+      if (frameType == 247) {
+        // same_locals_1_stack_item_frame_extended
+        stackSlots = readVerificationType(bytes, pos);
+      } else if (frameType >= 252 && frameType <= 254) {
+        // append_frame
+        for (uint8_t local = 0; local < frameType - 251; local++) { readVerificationType(bytes, pos); }
+      } else if (frameType == 255) {
+        // full_frame
+        uint16_t localCount = readuint16(bytes, pos);
+        pos += 2;
+        for (uint16_t local = 0; local < localCount; local++) { readVerificationType(bytes, pos); }
+        uint16_t stackCount = readuint16(bytes, pos);
+        pos += 2;
+        for (uint16_t item = 0; item < stackCount; item++) { stackSlots += readVerificationType(bytes, pos); }
+      }
+      // chop_frame and same_frame_extended have an empty stack
+    }
+
+    // The first explicit frame is at offsetDelta, every later one at previous + offsetDelta + 1
+    size_t frameOffset = i == 0 ? offsetDelta : frames.back().offset + offsetDelta + 1;
+    if (frameOffset > UINT16_MAX) {
+      throw InvalidArgument("Frame offset {} exceeds code length"_format(frameOffset));
+    }
+    if (frameOffset == 0) {
+      frames.back().stackSlots = stackSlots;
+    } else {
+      frames.push_back(StackMapFrame{static_cast<uint16_t>(frameOffset), stackSlots});
+    }
+  }
+
+  if (pos != end) {
+    throw InvalidArgument("StackMapTable length {} does not match its {} frames"_format(length, count));
+  }
+}
+
+const StackMapFrame &StackMapTable::findFrameBefore(size_t location) const {
+  auto it = std::upper_bound(frames.begin(), frames.end(), location,
+                             [](size_t loc, const StackMapFrame &frame) { return loc < frame.offset; });
+  return *(it - 1);
+}
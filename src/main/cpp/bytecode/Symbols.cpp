@@ -0,0 +1,115 @@
+#include "bytecode/Symbols.h"
+
+#include <array>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <stdexcept>
+#include <unordered_map>
+
+#include "util.h"
+
+static std::string_view keyOf(const std::string &symbol) { return symbol; }
+
+static std::string_view keyOf(const TypeDescriptor &type) { return type.descriptor; }
+
+static std::string_view keyOf(const MethodDescriptor &method) { return method.descriptor; }
+
+/**
+ * Map from a string to a value parsed from it. Keys are views into the string stored in the value,
+ * so lookups need no allocation. Values are never removed which keeps references to them stable.
+ */
+template<typename T>
+class Interner {
+  static const size_t SHARD_COUNT = 16;
+
+  struct Shard {
+    std::shared_mutex mutex;
+    std::unordered_map<std::string_view, std::unique_ptr<const T>> entries;
+  };
+
+  std::array<Shard, SHARD_COUNT> shards;
+
+public:
+  template<typename Parse>
+  const T &intern(std::string_view key, Parse parse) {
+    Shard &shard = shards[std::hash<std::string_view>()(key) % SHARD_COUNT];
+    {
+      std::shared_lock<std::shared_mutex> lock(shard.mutex);
+      if (auto it = shard.entries.find(key); it != shard.entries.end()) { return *it->second; }
+    }
+
+    // Parsed without holding the lock, if another thread wins the race its value is used instead
+    auto value = std::make_unique<const T>(parse(key));
+    std::unique_lock<std::shared_mutex> lock(shard.mutex);
+    std::string_view storedKey = keyOf(*value);
+    return *shard.entries.try_emplace(storedKey, std::move(value)).first->second;
+  }
+
+  size_t size() {
+    size_t total = 0;
+    for (Shard &shard : shards) {
+      std::shared_lock<std::shared_mutex> lock(shard.mutex);
+      total += shard.entries.size();
+    }
+    return total;
+  }
+};
+
+static Interner<std::string> symbols;
+static Interner<TypeDescriptor> classNames;
+static Interner<TypeDescriptor> fieldTypes;
+static Interner<MethodDescriptor> methodDescriptors;
+
+static uint8_t typeLength(std::string_view descriptor) {
+  return (descriptor == "J" || descriptor == "D") ? 2 : 1;
+}
+
+const std::string &Symbols::intern(std::string_view symbol) {
+  return symbols.intern(symbol, [](std::string_view key) { return std::string(key); });
+}
+
+const TypeDescriptor &Symbols::className(std::string_view internalName) {
+  return classNames.intern(internalName, [](std::string_view key) {
+    return TypeDescriptor{std::string(key), toJavaClassName(key), 1};
+  });
+}
+
+const TypeDescriptor &Symbols::fieldType(std::string_view descriptor) {
+  return fieldTypes.intern(descriptor, [](std::string_view key) {
+    return TypeDescriptor{std::string(key), toJavaTypeName(key), typeLength(key)};
+  });
+}
+
+const MethodDescriptor &Symbols::methodDescriptor(std::string_view descriptor) {
+  return methodDescriptors.intern(descriptor, [](std::string_view key) {
+    if (key.empty() || key[0] != '(') {
+      throw std::invalid_argument("Signature must begin with '('");
+    }
+
+    MethodDescriptor method{std::string(key), {}, {}, 0, 0};
+    size_t pos = 1;
+    while (pos < key.size()) {
+      if (key[pos] == ')') {
+        pos++;
+        continue;
+      }
+      size_t start = pos;
+      std::string type = toJavaTypeName(key, pos, &pos);
+
+      if (pos != key.size()) {
+        method.parameterLength += typeLength(key.substr(start, pos - start));
+        method.parameterTypes.push_back(std::move(type));
+      } else {
+        method.returnLength = key[start] == 'V' ? 0 : typeLength(key.substr(start));
+        method.returnType = std::move(type);
+      }
+    }
+    return method;
+  });
+}
+
+size_t Symbols::size() {
+  return symbols.size() + classNames.size() + fieldTypes.size() + methodDescriptors.size();
+}
@@ -0,0 +1,98 @@
+#include "cache/BlameCache.h"
+
+#include <algorithm>
+#include <chrono>
+
+#include "options.h"
+
+BlameCache::BlameCache(size_t maxSize) : maxShardSize(std::max<size_t>(1, maxSize / SHARD_COUNT)) {
+}
+
+BlameCache::Description BlameCache::getOrCompute(jmethodID method, jlocation location,
+                                                  const std::function<Description()> &compute) {
+  Key key{method, location};
+  Shard &shard = shardFor(key);
+
+  std::promise<Description> promise;
+  std::unique_lock<std::mutex> lock(shard.mutex);
+  if (auto it = shard.entries.find(key); it != shard.entries.end()) {
+    std::shared_future<Description> result = it->second.future;
+    lock.unlock();
+    hits.fetch_add(1, std::memory_order_relaxed);
+    // Blocks if another thread is still computing this site
+    return result.get();
+  }
+
+  if (shard.entries.size() >= maxShardSize) { evictOne(shard); }
+  uint64_t ticket = shard.nextTicket++;
+  shard.entries.emplace(key, Entry{promise.get_future().share(), ticket});
+  lock.unlock();
+  misses.fetch_add(1, std::memory_order_relaxed);
+
+  try {
+    Description description = compute();
+    promise.set_value(description);
+    return description;
+  } catch (...) {
+    promise.set_exception(std::current_exception());
+    // Don't remember failures, the next NPE at this site tries again
+    lock.lock();
+    // The entry may have been evicted and the site computed again meanwhile, only erase our own
+    if (auto it = shard.entries.find(key); it != shard.entries.end() && it->second.ticket == ticket) {
+      shard.entries.erase(it);
+    }
+    throw;
+  }
+}
+
+void BlameCache::evictOne(Shard &shard) {
+  if (shard.entries.empty()) { return; }
+
+  // Entries still being computed will likely be looked up again soon, evict the first finished one
+  for (auto it = shard.entries.begin(); it != shard.entries.end(); it++) {
+    if (it->second.future.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+      shard.entries.erase(it);
+      return;
+    }
+  }
+  // All in flight, evicting one anyway keeps the shard bounded. Its waiters hold copies of the future
+  shard.entries.erase(shard.entries.begin());
+}
+
+size_t BlameCache::evict(const std::unordered_set<jmethodID> &methods) {
+  size_t evicted = 0;
+  for (Shard &shard : shards) {
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    // Sites still being computed are removed too, their waiters hold the future
+    for (auto it = shard.entries.begin(); it != shard.entries.end();) {
+      if (methods.count(it->first.first) != 0) {
+        it = shard.entries.erase(it);
+        evicted++;
+      } else {
+        it++;
+      }
+    }
+  }
+  return evicted;
+}
+
+void BlameCache::clear() {
+  for (Shard &shard : shards) {
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    shard.entries.clear();
+  }
+}
+
+size_t BlameCache::size() const {
+  size_t total = 0;
+  for (const Shard &shard : shards) {
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    total += shard.entries.size();
+  }
+  return total;
+}
+
+BlameCache &BlameCache::instance() {
+  static BlameCache cache(AgentOptions::get().cacheSize);
+  return cache;
+}
@@ -0,0 +1,219 @@
+#include "cache/BlameIndex.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <unordered_map>
+#include <fmt/fmt.h>
+
+#include "util.h"
+
+using fmt::literals::operator""_format;
+
+static auto logger = getLogger("BlameIndex");
+
+static const char MAGIC[8] = {'N', 'P', 'E', 'B', 'I', 'D', 'X', '\0'};
+// Written in native order, reads back differently on a machine with the other byte order
+static const uint32_t BYTE_ORDER_MARK = 0x01020304;
+
+struct Header {
+  char magic[8];
+  uint32_t version;
+  uint32_t byteOrder;
+  uint64_t methodCount;
+  uint64_t siteCount;
+  uint64_t methodsOffset;
+  uint64_t sitesOffset;
+  uint64_t stringsOffset;
+  uint64_t stringsLength;
+};
+
+static_assert(sizeof(Header) == 64);
+static_assert(sizeof(BlameIndex::MethodRecord) == 24);
+
+static size_t align(size_t offset) {
+  return (offset + 7) & ~static_cast<size_t>(7);
+}
+
+// ****************************************
+// ******          Builder          *******
+// ****************************************
+
+void BlameIndex::Builder::addMethod(std::string key, uint64_t codeHash,
+                                    std::vector<std::pair<size_t, std::string>> sites) {
+  methods.push_back(IndexedMethod{std::move(key), codeHash, std::move(sites)});
+}
+
+template<typename T>
+static void writeRecords(std::ofstream &out, const std::vector<T> &records) {
+  out.write(reinterpret_cast<const char *>(records.data()), static_cast<std::streamsize>(records.size() * sizeof(T)));
+}
+
+static void writePadding(std::ofstream &out, size_t offset) {
+  static const char zeros[8] = {};
+  out.write(zeros, static_cast<std::streamsize>(align(offset) - offset));
+}
+
+void BlameIndex::Builder::write(const std::string &path) {
+  std::sort(methods.begin(), methods.end(),
+            [](const IndexedMethod &a, const IndexedMethod &b) { return a.key < b.key; });
+
+  std::string strings;
+  std::unordered_map<std::string, uint32_t> descriptionOffsets;
+  auto addString = [&](const std::string &string) {
+    auto [it, inserted] = descriptionOffsets.emplace(string, static_cast<uint32_t>(strings.size()));
+    if (inserted) { strings += string; }
+    if (strings.size() > UINT32_MAX) { throw std::runtime_error("Index strings exceed 4GB"); }
+    return it->second;
+  };
+
+  std::vector<MethodRecord> methodRecords;
+  std::vector<SiteRecord> siteRecords;
+  methodRecords.reserve(methods.size());
+  for (size_t i = 0; i < methods.size(); i++) {
+    const IndexedMethod &method = methods[i];
+    if (i > 0 && methods[i - 1].key == method.key) {
+      throw std::runtime_error("Duplicate method {}"_format(method.key));
+    }
+
+    // Keys are unique, only descriptions are worth deduplicating
+    uint32_t keyOffset = static_cast<uint32_t>(strings.size());
+    strings += method.key;
+    methodRecords.push_back(MethodRecord{method.codeHash, keyOffset, static_cast<uint32_t>(method.key.size()),
+                                         static_cast<uint32_t>(siteRecords.size()),
+                                         static_cast<uint32_t>(method.sites.size())});
+    for (const auto &[location, description] : method.sites) {
+      siteRecords.push_back(SiteRecord{static_cast<uint32_t>(location), addString(description),
+                                       static_cast<uint32_t>(description.size())});
+    }
+  }
+
+  Header header{};
+  std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+  header.version = VERSION;
+  header.byteOrder = BYTE_ORDER_MARK;
+  header.methodCount = methodRecords.size();
+  header.siteCount = siteRecords.size();
+  header.methodsOffset = sizeof(Header);
+  header.sitesOffset = align(header.methodsOffset + methodRecords.size() * sizeof(MethodRecord));
+  header.stringsOffset = align(header.sitesOffset + siteRecords.size() * sizeof(SiteRecord));
+  header.stringsLength = strings.size();
+
+  // Unique per writer, concurrent writers of the same path each rename a complete file
+  std::string tempPath = "{}.{}.tmp"_format(path, std::chrono::steady_clock::now().time_since_epoch().count());
+  std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+  if (!out) { throw std::runtime_error("Failed to open {} for writing"_format(tempPath)); }
+
+  out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+  writeRecords(out, methodRecords);
+  writePadding(out, header.methodsOffset + methodRecords.size() * sizeof(MethodRecord));
+  writeRecords(out, siteRecords);
+  writePadding(out, header.sitesOffset + siteRecords.size() * sizeof(SiteRecord));
+  out.write(strings.data(), static_cast<std::streamsize>(strings.size()));
+
+  out.close();
+  std::error_code error;
+  if (out) { std::filesystem::rename(tempPath, path, error); }
+  if (!out || error) {
+    std::filesystem::remove(tempPath, error);
+    throw std::runtime_error("Failed to write {}"_format(path));
+  }
+}
+
+// ****************************************
+// ******          Reader           *******
+// ****************************************
+
+BlameIndex::BlameIndex(const std::string &path) : file(std::make_unique<MappedFile>(path)) {
+  ByteView bytes = file->getBytes();
+  if (bytes.size() < sizeof(Header)) { throw std::runtime_error("{} is not an NPE index"_format(path)); }
+
+  Header header;
+  std::memcpy(&header, bytes.data(), sizeof(Header));
+  if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0) {
+    throw std::runtime_error("{} is not an NPE index"_format(path));
+  }
+  if (header.version != VERSION || header.byteOrder != BYTE_ORDER_MARK) {
+    throw std::runtime_error("{} has index version {}, expected {}, rebuild it with this agent's indexer"_format(
+        path, header.version, VERSION));
+  }
+
+  // Sections must fit the file and be aligned for the records to be read in place
+  bool valid = header.methodCount <= bytes.size() / sizeof(MethodRecord) &&
+               header.siteCount <= bytes.size() / sizeof(SiteRecord) &&
+               header.methodsOffset <= bytes.size() && header.sitesOffset <= bytes.size() &&
+               header.methodsOffset % 8 == 0 && header.sitesOffset % 8 == 0 &&
+               header.methodsOffset + header.methodCount * sizeof(MethodRecord) <= header.sitesOffset &&
+               header.sitesOffset + header.siteCount * sizeof(SiteRecord) <= header.stringsOffset &&
+               header.stringsOffset <= bytes.size() && header.stringsLength <= bytes.size() - header.stringsOffset;
+  if (!valid) { throw std::runtime_error("{} is truncated or corrupt"_format(path)); }
+
+  methods = reinterpret_cast<const MethodRecord *>(bytes.data() + header.methodsOffset);
+  sites = reinterpret_cast<const SiteRecord *>(bytes.data() + header.sitesOffset);
+  strings = bytes.subview(header.stringsOffset, header.stringsLength);
+  methodCount = header.methodCount;
+  siteCount = header.siteCount;
+}
+
+std::string BlameIndex::methodKey(std::string_view className, std::string_view methodName,
+                                  std::string_view descriptor) {
+  std::string key;
+  key.reserve(className.size() + methodName.size() + descriptor.size() + 1);
+  key.append(className).append(".").append(methodName).append(descriptor);
+  return key;
+}
+
+std::string_view BlameIndex::getString(uint32_t offset, uint32_t length) const {
+  // Records are not trusted, a corrupt offset must not read outside the mapping
+  if (static_cast<size_t>(offset) + length > strings.size()) { return std::string_view(); }
+  return std::string_view(reinterpret_cast<const char *>(strings.data()) + offset, length);
+}
+
+const BlameIndex::MethodRecord *BlameIndex::findMethod(std::string_view key, uint64_t codeHash) const {
+  const MethodRecord *end = methods + methodCount;
+  const MethodRecord *it = std::lower_bound(methods, end, key, [this](const MethodRecord &method, std::string_view k) {
+    return getString(method.keyOffset, method.keyLength) < k;
+  });
+  if (it == end || getString(it->keyOffset, it->keyLength) != key || it->codeHash != codeHash) { return nullptr; }
+  if (static_cast<size_t>(it->firstSite) + it->siteCount > siteCount) { return nullptr; }
+  return it;
+}
+
+std::vector<std::pair<size_t, std::string>> BlameIndex::getSites(const MethodRecord &method) const {
+  std::vector<std::pair<size_t, std::string>> result;
+  if (static_cast<size_t>(method.firstSite) + method.siteCount > siteCount) { return result; }
+
+  result.reserve(method.siteCount);
+  for (const SiteRecord *site = sites + method.firstSite; site != sites + method.firstSite + method.siteCount; site++) {
+    result.emplace_back(site->location, getString(site->descriptionOffset, site->descriptionLength));
+  }
+  return result;
+}
+
+std::optional<std::string_view> BlameIndex::findSite(const MethodRecord &method, size_t location) const {
+  const SiteRecord *begin = sites + method.firstSite;
+  const SiteRecord *end = begin + method.siteCount;
+  const SiteRecord *it = std::lower_bound(begin, end, location, [](const SiteRecord &site, size_t loc) {
+    return site.location < loc;
+  });
+  if (it == end || it->location != location) { return std::nullopt; }
+  return getString(it->descriptionOffset, it->descriptionLength);
+}
+
+static std::unique_ptr<const BlameIndex> loadedIndex;
+
+const BlameIndex *BlameIndex::get() {
+  return loadedIndex.get();
+}
+
+void BlameIndex::load(const std::string &path) {
+  try {
+    loadedIndex = std::make_unique<const BlameIndex>(path);
+    logger->debug("Loaded NPE index {}: {} methods, {} sites", path, loadedIndex->size(), loadedIndex->getSiteCount());
+  } catch (const std::exception &e) {
+    logger->warn("Not using NPE index: {}", e.what());
+  }
+}
@@ -0,0 +1,70 @@
+#include "cache/BlameTable.h"
+
+#include <algorithm>
+#include <mutex>
+#include <unordered_map>
+
+BlameTable::BlameTable(const std::vector<std::pair<size_t, std::string>> &locatedDescriptions) {
+  entries.reserve(locatedDescriptions.size());
+  // Sites in the same method often share a description, e.g. several calls on the same null parameter
+  std::unordered_map<std::string_view, uint32_t> stored;
+  for (const auto &[location, description] : locatedDescriptions) {
+    auto [it, inserted] = stored.try_emplace(description, static_cast<uint32_t>(descriptions.size()));
+    if (inserted) { descriptions += description; }
+    entries.push_back(Entry{static_cast<uint32_t>(location), it->second, static_cast<uint32_t>(description.size())});
+  }
+  descriptions.shrink_to_fit();
+}
+
+std::optional<std::string_view> BlameTable::find(size_t location) const {
+  auto it = std::lower_bound(entries.begin(), entries.end(), location,
+                             [](const Entry &entry, size_t loc) { return entry.location < loc; });
+  if (it == entries.end() || it->location != location) { return std::nullopt; }
+  return std::string_view(descriptions).substr(it->descriptionOffset, it->descriptionLength);
+}
+
+size_t BlameTable::memoryUsage() const {
+  return sizeof(BlameTable) + entries.capacity() * sizeof(Entry) + descriptions.capacity();
+}
+
+static std::mutex cacheMutex;
+static std::unordered_map<jmethodID, std::shared_ptr<const BlameTable>> tables;
+static size_t tablesMemoryUsage = 0;
+
+std::shared_ptr<const BlameTable> BlameTableCache::get(jmethodID method, const std::function<BlameTable()> &build) {
+  {
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    if (auto it = tables.find(method); it != tables.end()) { return it->second; }
+  }
+
+  // Built without holding the lock, analyzing a method must not block NPEs in other methods
+  auto table = std::make_shared<const BlameTable>(build());
+
+  std::lock_guard<std::mutex> lock(cacheMutex);
+  auto [it, inserted] = tables.emplace(method, table);
+  if (inserted) { tablesMemoryUsage += table->memoryUsage(); }
+  return it->second;
+}
+
+size_t BlameTableCache::evict(const std::unordered_set<jmethodID> &methods) {
+  std::lock_guard<std::mutex> lock(cacheMutex);
+  size_t evicted = 0;
+  for (jmethodID method : methods) {
+    if (auto it = tables.find(method); it != tables.end()) {
+      tablesMemoryUsage -= it->second->memoryUsage();
+      tables.erase(it);
+      evicted++;
+    }
+  }
+  return evicted;
+}
+
+size_t BlameTableCache::size() {
+  std::lock_guard<std::mutex> lock(cacheMutex);
+  return tables.size();
+}
+
+size_t BlameTableCache::memoryUsage() {
+  std::lock_guard<std::mutex> lock(cacheMutex);
+  return tablesMemoryUsage;
+}
@@ -0,0 +1,296 @@
+#include "cache/ClassImageStore.h"
+
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <fmt/fmt.h>
+
+#ifdef NPEBLAME_ZLIB
+#include <zlib.h>
+#endif
+
+#include "cache/ClassRegistry.h"
+#include "options.h"
+#include "util.h"
+
+using fmt::literals::operator""_format;
+
+// Version 50 class files may omit frames and fall back to type inference, from 51 every branch target has one
+static const uint16_t STACK_MAP_REQUIRED_VERSION = 51;
+
+ClassImage::ClassImage(std::vector<uint8_t> classBytes) : bytes(std::move(classBytes)) {
+  ClassFile classFile{ByteView(bytes)};
+  constPool = classFile.getConstPool();
+  bool hasStackMaps = classFile.getMajorVersion() >= STACK_MAP_REQUIRED_VERSION;
+
+  for (const MemberInfo &method : classFile.getMethods()) {
+    const AttributeInfo *codeAttribute = classFile.findAttribute(method.attributes, "Code");
+    if (codeAttribute == nullptr) { continue; }
+
+    CodeInfo code = classFile.readCode(*codeAttribute);
+    ByteView methodCode = ByteView(bytes).subview(code.codeOffset, code.codeLength);
+    MethodImage image{method.nameIndex, method.descriptorIndex, methodCode, ByteVectorUtil::hash(methodCode),
+                      LocalVariableTable(), StackMapTable(), std::move(code.handlerPcs)};
+
+    if (const AttributeInfo *variables = classFile.findAttribute(code.attributes, "LocalVariableTable")) {
+      image.localVariables = classFile.readLocalVariableTable(*variables);
+    }
+
+    const AttributeInfo *stackMap = classFile.findAttribute(code.attributes, "StackMapTable");
+    if (hasStackMaps && stackMap != nullptr) {
+      image.stackMap = StackMapTable(bytes, stackMap->offset + 6, stackMap->length);
+    }
+
+    methods.push_back(std::move(image));
+  }
+}
+
+const MethodImage *ClassImage::findMethod(std::string_view name, std::string_view descriptor) const {
+  for (const MethodImage &method : methods) {
+    if (constPool.getUtf8(method.nameIndex) == name && constPool.getUtf8(method.descriptorIndex) == descriptor) {
+      return &method;
+    }
+  }
+  return nullptr;
+}
+
+// ****************************************
+// ******          Packing          *******
+// ****************************************
+
+/**
+ * Class image as stored, a class file stripped to what ClassImage reads
+ */
+struct PackedImage {
+  uint64_t hash;
+  uint32_t unpackedSize;
+  std::vector<uint8_t> bytes;
+  // Unpacked image while anyone uses it, guarded by storeMutex
+  mutable std::weak_ptr<const ClassImage> unpacked;
+};
+
+/**
+ * Copy of the class file without interfaces, fields, class attributes, methods without code and
+ * attributes of Code other than LocalVariableTable and StackMapTable
+ */
+static std::vector<uint8_t> stripClassFile(const ClassFile &classFile) {
+  ByteView bytes = classFile.getBytes();
+  const ConstPool &constPool = classFile.getConstPool();
+  size_t constPoolEnd = classFile.getConstPoolEnd();
+
+  // Header and constant pool, then access_flags, this_class and super_class
+  std::vector<uint8_t> stripped(bytes.begin(), bytes.begin() + constPoolEnd + 6);
+  ByteVectorUtil::writeuint16(stripped, 0); // interfaces_count
+  ByteVectorUtil::writeuint16(stripped, 0); // fields_count
+
+  std::vector<std::pair<const MemberInfo *, const AttributeInfo *>> methods;
+  for (const MemberInfo &method : classFile.getMethods()) {
+    if (const AttributeInfo *codeAttribute = classFile.findAttribute(method.attributes, "Code")) {
+      methods.emplace_back(&method, codeAttribute);
+    }
+  }
+
+  ByteVectorUtil::writeuint16(stripped, static_cast<uint16_t>(methods.size()));
+  for (auto [method, codeAttribute] : methods) {
+    ByteVectorUtil::writeuint16(stripped, method->accessFlags);
+    ByteVectorUtil::writeuint16(stripped, method->nameIndex);
+    ByteVectorUtil::writeuint16(stripped, method->descriptorIndex);
+    ByteVectorUtil::writeuint16(stripped, 1);
+
+    CodeInfo code = classFile.readCode(*codeAttribute);
+    std::vector<const AttributeInfo *> kept;
+    for (const AttributeInfo &attribute : code.attributes) {
+      std::string_view name = constPool.getUtf8(attribute.nameIndex);
+      if (name == "LocalVariableTable" || name == "StackMapTable") { kept.push_back(&attribute); }
+    }
+
+    // max_stack up to the end of the exception table is copied as is
+    size_t exceptionTable = code.codeOffset + code.codeLength;
+    size_t headerEnd = exceptionTable + 2 + 8 * ByteVectorUtil::readuint16(bytes, exceptionTable);
+    size_t length = headerEnd - (codeAttribute->offset + 6) + 2;
+    for (const AttributeInfo *attribute : kept) { length += 6 + attribute->length; }
+
+    ByteVectorUtil::writeuint16(stripped, codeAttribute->nameIndex);
+    ByteVectorUtil::writeuint32(stripped, static_cast<uint32_t>(length));
+    stripped.insert(stripped.end(), bytes.begin() + codeAttribute->offset + 6, bytes.begin() + headerEnd);
+    ByteVectorUtil::writeuint16(stripped, static_cast<uint16_t>(kept.size()));
+    for (const AttributeInfo *attribute : kept) {
+      stripped.insert(stripped.end(), bytes.begin() + attribute->offset,
+                      bytes.begin() + attribute->offset + 6 + attribute->length);
+    }
+  }
+
+  ByteVectorUtil::writeuint16(stripped, 0); // attributes_count
+  return stripped;
+}
+
+static std::vector<uint8_t> packBytes(const std::vector<uint8_t> &bytes) {
+#ifdef NPEBLAME_ZLIB
+  uLongf packedLength = compressBound(static_cast<uLong>(bytes.size()));
+  std::vector<uint8_t> packed(packedLength);
+  // Every loaded class goes through here, the fastest level already halves the size
+  int result = compress2(packed.data(), &packedLength, bytes.data(), static_cast<uLong>(bytes.size()), Z_BEST_SPEED);
+  if (result != Z_OK) {
+    throw std::runtime_error("Failed to compress class image: zlib error {}"_format(result));
+  }
+  packed.resize(packedLength);
+  packed.shrink_to_fit();
+  return packed;
+#else
+  return bytes;
+#endif
+}
+
+static std::vector<uint8_t> unpackBytes(const PackedImage &image) {
+#ifdef NPEBLAME_ZLIB
+  std::vector<uint8_t> bytes(image.unpackedSize);
+  uLongf length = image.unpackedSize;
+  int result = uncompress(bytes.data(), &length, image.bytes.data(), static_cast<uLong>(image.bytes.size()));
+  if (result != Z_OK || length != image.unpackedSize) {
+    throw std::runtime_error("Failed to uncompress class image: zlib error {}"_format(result));
+  }
+  return bytes;
+#else
+  return image.bytes;
+#endif
+}
+
+static size_t imageMemoryUsage(const PackedImage &image) {
+  return sizeof(PackedImage) + image.bytes.capacity();
+}
+
+// ****************************************
+// ******           Store           *******
+// ****************************************
+
+struct StoredImage {
+  std::shared_ptr<const PackedImage> image;
+  // Classes using the image
+  size_t references;
+};
+
+using LoaderImages = std::unordered_map<std::string, std::shared_ptr<const PackedImage>>;
+
+static std::mutex storeMutex;
+// By loader id, see ClassRegistry, and internal class name
+static std::unordered_map<jlong, LoaderImages> classImages;
+static std::unordered_multimap<uint64_t, StoredImage> distinctImages;
+static size_t classCount = 0;
+static size_t storedBytes = 0;
+static size_t rejectedImages = 0;
+
+/**
+ * Must hold storeMutex
+ */
+static void releaseImage(const std::shared_ptr<const PackedImage> &image) {
+  auto [begin, end] = distinctImages.equal_range(image->hash);
+  for (auto it = begin; it != end; it++) {
+    if (it->second.image != image) { continue; }
+    if (--it->second.references == 0) {
+      storedBytes -= imageMemoryUsage(*image);
+      distinctImages.erase(it);
+    }
+    return;
+  }
+}
+
+void ClassImageStore::record(jobject loader, const ClassFile &classFile) {
+  std::vector<uint8_t> stripped = stripClassFile(classFile);
+  auto packed = std::make_shared<PackedImage>();
+  // Equal hashes are confirmed by comparing the packed bytes
+  packed->hash = ByteVectorUtil::hash(stripped);
+  packed->unpackedSize = static_cast<uint32_t>(stripped.size());
+  packed->bytes = packBytes(stripped);
+  std::string_view className = classFile.getConstPool().getClassName(classFile.getThisClass());
+
+  jlong loaderId = ClassRegistry::loaderId(loader, true);
+  std::lock_guard<std::mutex> lock(storeMutex);
+  LoaderImages &loaderImages = classImages[loaderId];
+  if (auto previous = loaderImages.find(std::string(className)); previous != loaderImages.end()) {
+    // Redefined class, the old image must not be used even if the new one is rejected
+    releaseImage(previous->second);
+    loaderImages.erase(previous);
+    classCount--;
+  }
+
+  std::shared_ptr<const PackedImage> image;
+  auto [begin, end] = distinctImages.equal_range(packed->hash);
+  for (auto it = begin; it != end; it++) {
+    if (it->second.image->unpackedSize == packed->unpackedSize && it->second.image->bytes == packed->bytes) {
+      it->second.references++;
+      image = it->second.image;
+      break;
+    }
+  }
+
+  if (image == nullptr) {
+    size_t usage = imageMemoryUsage(*packed);
+    if (storedBytes + usage > memoryLimit()) {
+      rejectedImages++;
+      return;
+    }
+    storedBytes += usage;
+    image = packed;
+    distinctImages.emplace(packed->hash, StoredImage{image, 1});
+  }
+  loaderImages.emplace(className, std::move(image));
+  classCount++;
+}
+
+std::shared_ptr<const ClassImage> ClassImageStore::find(jobject loader, std::string_view className) {
+  jlong loaderId = ClassRegistry::loaderId(loader, false);
+  // Untagged loader had no classes loaded while the agent was recording
+  if (loader != nullptr && loaderId == 0) { return nullptr; }
+
+  std::shared_ptr<const PackedImage> packed;
+  {
+    std::lock_guard<std::mutex> lock(storeMutex);
+    auto loaderImages = classImages.find(loaderId);
+    if (loaderImages == classImages.end()) { return nullptr; }
+    auto it = loaderImages->second.find(std::string(className));
+    if (it == loaderImages->second.end()) { return nullptr; }
+    packed = it->second;
+    if (std::shared_ptr<const ClassImage> image = packed->unpacked.lock()) { return image; }
+  }
+
+  // Unpacked without holding the lock, another thread may unpack the same image in the meantime
+  auto image = std::make_shared<const ClassImage>(unpackBytes(*packed));
+
+  std::lock_guard<std::mutex> lock(storeMutex);
+  packed->unpacked = image;
+  return image;
+}
+
+size_t ClassImageStore::evictLoader(jlong loaderId) {
+  std::lock_guard<std::mutex> lock(storeMutex);
+  auto loaderImages = classImages.find(loaderId);
+  if (loaderImages == classImages.end()) { return 0; }
+
+  size_t evicted = loaderImages->second.size();
+  for (const auto &[className, image] : loaderImages->second) {
+    releaseImage(image);
+  }
+  classImages.erase(loaderImages);
+  classCount -= evicted;
+  return evicted;
+}
+
+size_t ClassImageStore::memoryLimit() {
+  return AgentOptions::get().classImageMemory;
+}
+
+size_t ClassImageStore::size() {
+  std::lock_guard<std::mutex> lock(storeMutex);
+  return classCount;
+}
+
+size_t ClassImageStore::memoryUsage() {
+  std::lock_guard<std::mutex> lock(storeMutex);
+  return storedBytes;
+}
+
+size_t ClassImageStore::rejected() {
+  std::lock_guard<std::mutex> lock(storeMutex);
+  return rejectedImages;
+}
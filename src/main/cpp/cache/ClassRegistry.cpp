@@ -0,0 +1,177 @@
+#include "cache/ClassRegistry.h"
+
+#include <atomic>
+#include <mutex>
+#include <unordered_set>
+#include <vector>
+
+#include "api/Jvmti.h"
+#include "cache/BlameCache.h"
+#include "cache/BlameTable.h"
+#include "cache/ClassImageStore.h"
+#include "cache/ConstPoolCache.h"
+#include "cache/IndexedMethodCache.h"
+#include "cache/MethodCache.h"
+#include "cache/StackFlowCache.h"
+#include "util.h"
+
+struct ClassSlot {
+  std::string internalName;
+  // Methods with cache entries
+  std::unordered_set<jmethodID> methods;
+};
+
+// Tags are read and assigned under it, a class tagged by two threads at once would get two handles
+static std::mutex registryMutex;
+// Handle minus one is the index
+static std::vector<ClassSlot> classSlots;
+static std::vector<jlong> freeHandles;
+static size_t classCount = 0;
+static jlong nextLoaderId = -1;
+
+// Never held across JVM calls, ObjectFree can always take it
+static std::mutex queueMutex;
+static std::vector<jlong> freedTags;
+static std::atomic<bool> hasFreedTags{false};
+
+static std::atomic<size_t> evictedEntries{0};
+
+/**
+ * Must hold registryMutex
+ */
+static jlong handleLocked(jclass klass) {
+  jlong tag = Jvmti::getTag(klass);
+  if (tag != 0) { return tag; }
+
+  std::string signature = Jvmti::getClassSignature(klass);
+  ClassSlot slot{signature.size() > 2 && signature.front() == 'L' ? signature.substr(1, signature.size() - 2)
+                                                                   : signature, {}};
+  if (freeHandles.empty()) {
+    classSlots.push_back(std::move(slot));
+    tag = static_cast<jlong>(classSlots.size());
+  } else {
+    tag = freeHandles.back();
+    freeHandles.pop_back();
+    classSlots[tag - 1] = std::move(slot);
+  }
+  Jvmti::setTag(klass, tag);
+  classCount++;
+  return tag;
+}
+
+jlong ClassRegistry::handle(jclass klass) {
+  std::lock_guard<std::mutex> lock(registryMutex);
+  return handleLocked(klass);
+}
+
+jlong ClassRegistry::loaderId(jobject loader, bool assign) {
+  if (loader == nullptr) { return 0; }
+
+  std::lock_guard<std::mutex> lock(registryMutex);
+  jlong tag = Jvmti::getTag(loader);
+  if (tag == 0 && assign) {
+    tag = nextLoaderId--;
+    Jvmti::setTag(loader, tag);
+  }
+  return tag;
+}
+
+std::string ClassRegistry::getClassName(jclass klass) {
+  std::string internalName = getInternalClassName(klass);
+  std::string name = toJavaClassName(internalName);
+  // Internal names can't contain a '.' except before the suffix of a hidden class, which getName shows as '/'
+  if (size_t hiddenSuffix = internalName.find('.'); hiddenSuffix != std::string::npos) { name[hiddenSuffix] = '/'; }
+  return name;
+}
+
+std::string ClassRegistry::getInternalClassName(jclass klass) {
+  std::lock_guard<std::mutex> lock(registryMutex);
+  return classSlots[handleLocked(klass) - 1].internalName;
+}
+
+void ClassRegistry::trackMethod(jmethodID method) {
+  jclass declaringClass = Jvmti::getMethodDeclaringClass(method);
+  std::lock_guard<std::mutex> lock(registryMutex);
+  classSlots[handleLocked(declaringClass) - 1].methods.insert(method);
+}
+
+void ClassRegistry::evictUnloaded() {
+  if (!hasFreedTags.load(std::memory_order_acquire)) { return; }
+
+  std::vector<jlong> tags;
+  {
+    std::lock_guard<std::mutex> lock(queueMutex);
+    tags.swap(freedTags);
+    hasFreedTags.store(false, std::memory_order_release);
+  }
+
+  size_t evicted = 0;
+  std::unordered_set<jmethodID> methods;
+  std::vector<jlong> handles;
+  for (jlong tag : tags) {
+    if (tag < 0) {
+      evicted += ClassImageStore::evictLoader(tag);
+      continue;
+    }
+
+    evicted += ConstPoolCache::evict(tag);
+    std::lock_guard<std::mutex> lock(registryMutex);
+    methods.merge(classSlots[tag - 1].methods);
+    handles.push_back(tag);
+  }
+
+  // One pass over the method caches for all unloaded classes, a redeploy unloads thousands at once
+  if (!methods.empty()) {
+    evicted += BlameTableCache::evict(methods);
+    evicted += StackFlowCache::evict(methods);
+    evicted += IndexedMethodCache::evict(methods);
+    evicted += BlameCache::instance().evict(methods);
+    evicted += MethodCache::evict(methods);
+  }
+  evictedEntries.fetch_add(evicted, std::memory_order_relaxed);
+
+  // Only reused once nothing is cached under the handle anymore
+  std::lock_guard<std::mutex> lock(registryMutex);
+  for (jlong handle : handles) {
+    classSlots[handle - 1] = ClassSlot();
+    freeHandles.push_back(handle);
+    classCount--;
+  }
+}
+
+void ClassRegistry::evictRedefined(jclass klass) {
+  // Untagged classes have nothing cached
+  jlong handle = Jvmti::getTag(klass);
+  if (handle <= 0) { return; }
+
+  std::unordered_set<jmethodID> methods;
+  {
+    std::lock_guard<std::mutex> lock(registryMutex);
+    methods.swap(classSlots[handle - 1].methods);
+  }
+
+  size_t evicted = ConstPoolCache::evict(handle);
+  if (!methods.empty()) {
+    evicted += BlameTableCache::evict(methods);
+    evicted += StackFlowCache::evict(methods);
+    evicted += IndexedMethodCache::evict(methods);
+    evicted += BlameCache::instance().evict(methods);
+    evicted += MethodCache::evict(methods);
+  }
+  evictedEntries.fetch_add(evicted, std::memory_order_relaxed);
+}
+
+size_t ClassRegistry::evicted() {
+  return evictedEntries.load(std::memory_order_relaxed);
+}
+
+size_t ClassRegistry::size() {
+  std::lock_guard<std::mutex> lock(registryMutex);
+  return classCount;
+}
+
+void JNICALL ClassRegistry::objectFree(jvmtiEnv *jvmti, jlong tag) {
+  std::lock_guard<std::mutex> lock(queueMutex);
+  freedTags.push_back(tag);
+  hasFreedTags.store(true, std::memory_order_release);
+}
@@ -0,0 +1,46 @@
+#include "cache/ConstPoolCache.h"
+
+#include <mutex>
+#include <vector>
+
+#include "api/Jvmti.h"
+#include "cache/ClassRegistry.h"
+
+static std::mutex cacheMutex;
+// Handle of a class minus one is its index
+static std::vector<std::shared_ptr<const ConstPool>> constPools;
+static size_t constPoolCount = 0;
+
+std::shared_ptr<const ConstPool> ConstPoolCache::get(jclass klass) {
+  size_t index = static_cast<size_t>(ClassRegistry::handle(klass) - 1);
+  {
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    if (index < constPools.size() && constPools[index] != nullptr) { return constPools[index]; }
+  }
+
+  // Fetched without holding the lock, another thread may cache the same class in the meantime
+  std::shared_ptr<const ConstPool> constPool = Jvmti::getConstPool(klass);
+
+  std::lock_guard<std::mutex> lock(cacheMutex);
+  if (index >= constPools.size()) { constPools.resize(index + 1); }
+  if (constPools[index] == nullptr) {
+    constPools[index] = std::move(constPool);
+    constPoolCount++;
+  }
+  return constPools[index];
+}
+
+size_t ConstPoolCache::evict(jlong handle) {
+  std::lock_guard<std::mutex> lock(cacheMutex);
+  size_t index = static_cast<size_t>(handle - 1);
+  if (index >= constPools.size() || constPools[index] == nullptr) { return 0; }
+
+  constPools[index] = nullptr;
+  constPoolCount--;
+  return 1;
+}
+
+size_t ConstPoolCache::size() {
+  std::lock_guard<std::mutex> lock(cacheMutex);
+  return constPoolCount;
+}
@@ -0,0 +1,36 @@
+#include "cache/IndexedMethodCache.h"
+
+#include <mutex>
+#include <unordered_map>
+
+static std::mutex cacheMutex;
+// Null for methods that are not served from the index
+static std::unordered_map<jmethodID, const BlameIndex::MethodRecord *> records;
+
+const BlameIndex::MethodRecord *IndexedMethodCache::get(
+    jmethodID method, const std::function<const BlameIndex::MethodRecord *()> &lookup) {
+  {
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    if (auto it = records.find(method); it != records.end()) { return it->second; }
+  }
+
+  // Looked up without holding the lock, hashing a method must not block NPEs in other methods
+  const BlameIndex::MethodRecord *record = lookup();
+
+  std::lock_guard<std::mutex> lock(cacheMutex);
+  return records.emplace(method, record).first->second;
+}
+
+size_t IndexedMethodCache::evict(const std::unordered_set<jmethodID> &methods) {
+  std::lock_guard<std::mutex> lock(cacheMutex);
+  size_t evicted = 0;
+  for (jmethodID method : methods) {
+    evicted += records.erase(method);
+  }
+  return evicted;
+}
+
+size_t IndexedMethodCache::size() {
+  std::lock_guard<std::mutex> lock(cacheMutex);
+  return records.size();
+}
@@ -0,0 +1,55 @@
+#include "cache/MethodCache.h"
+
+#include <mutex>
+#include <unordered_map>
+
+#include "api/Jvmti.h"
+#include "cache/ClassRegistry.h"
+#include "util.h"
+
+static std::mutex cacheMutex;
+static std::unordered_map<jmethodID, std::shared_ptr<const MethodInfo>> methodInfos;
+
+static std::shared_ptr<const MethodInfo> fetch(jmethodID method) {
+  jclass declaringClass = Jvmti::getMethodDeclaringClass(method);
+  auto [name, signature] = Jvmti::getMethodNameAndSignature(method);
+  uint32_t modifiers = Jvmti::getMethodModifiers(method);
+  std::string className = ClassRegistry::getClassName(declaringClass);
+  std::string internalClassName = ClassRegistry::getInternalClassName(declaringClass);
+
+  // JVMTI has neither for native methods
+  bool isNative = (modifiers & Modifier::NATIVE) != 0;
+  return std::make_shared<const MethodInfo>(std::move(className), std::move(internalClassName), std::move(name),
+                                            signature, modifiers,
+                                            isNative ? 0 : Jvmti::getMethodArgumentsSize(method),
+                                            isNative ? LocalVariableTable() : Jvmti::getLocalVariableTable(method),
+                                            isNative ? 0 : ByteVectorUtil::hash(Jvmti::getBytecodes(method)));
+}
+
+std::shared_ptr<const MethodInfo> MethodCache::get(jmethodID method) {
+  {
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    if (auto it = methodInfos.find(method); it != methodInfos.end()) { return it->second; }
+  }
+
+  // Fetched without holding the lock, JVMTI calls must not block lookups of other methods
+  std::shared_ptr<const MethodInfo> info = fetch(method);
+  ClassRegistry::trackMethod(method);
+
+  std::lock_guard<std::mutex> lock(cacheMutex);
+  return methodInfos.emplace(method, std::move(info)).first->second;
+}
+
+size_t MethodCache::evict(const std::unordered_set<jmethodID> &methods) {
+  std::lock_guard<std::mutex> lock(cacheMutex);
+  size_t evicted = 0;
+  for (jmethodID method : methods) {
+    evicted += methodInfos.erase(method);
+  }
+  return evicted;
+}
+
+size_t MethodCache::size() {
+  std::lock_guard<std::mutex> lock(cacheMutex);
+  return methodInfos.size();
+}
@@ -0,0 +1,184 @@
+#include "cache/PersistentBlameCache.h"
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <fmt/fmt.h>
+
+#include "cache/BlameIndex.h"
+#include "util.h"
+
+using fmt::literals::operator""_format;
+
+namespace fs = std::filesystem;
+
+static auto logger = getLogger("PersistentBlameCache");
+
+static const char *const SEGMENT_EXTENSION = ".seg";
+// Left behind by a JVM killed while writing, a live writer renames its file within this time
+static const auto TEMP_FILE_AGE = std::chrono::hours(1);
+
+struct UsedMethod {
+  uint64_t codeHash;
+  std::vector<std::pair<size_t, std::string>> sites;
+};
+
+static std::mutex cacheMutex;
+// Empty if the cache is not open
+static std::string cacheDirectory;
+static size_t cacheSizeLimit = 0;
+// Newest first
+static std::vector<std::unique_ptr<const BlameIndex>> segments;
+// Loaded and unreadable segments, replaced by the one written on save
+static std::vector<fs::path> mergedSegments;
+static std::unordered_map<std::string, UsedMethod> usedMethods;
+static size_t recorded = 0;
+static size_t hits = 0;
+
+/**
+ * Bytes a method takes in a segment, not counting descriptions shared with other methods
+ */
+static size_t persistedSize(std::string_view key, const std::vector<std::pair<size_t, std::string>> &sites) {
+  size_t size = sizeof(BlameIndex::MethodRecord) + key.size();
+  for (const auto &site : sites) {
+    size += 3 * sizeof(uint32_t) + site.second.size();
+  }
+  return size;
+}
+
+void PersistentBlameCache::open(const std::string &directory, size_t sizeLimit) {
+  std::lock_guard<std::mutex> lock(cacheMutex);
+  std::error_code error;
+  fs::create_directories(directory, error);
+
+  std::vector<fs::path> files;
+  for (fs::directory_iterator it(directory, error), end; !error && it != end; it.increment(error)) {
+    fs::file_time_type modified = it->last_write_time(error);
+    if (error || !it->is_regular_file()) {
+      error.clear();
+      continue;
+    }
+
+    if (it->path().extension() == SEGMENT_EXTENSION) {
+      files.push_back(it->path());
+    } else if (it->path().extension() == ".tmp" && fs::file_time_type::clock::now() - modified > TEMP_FILE_AGE) {
+      fs::remove(it->path(), error);
+      error.clear();
+    }
+  }
+  if (error) {
+    logger->warn("Not using blame cache directory {}: {}", directory, error.message());
+    return;
+  }
+
+  // Names start with the creation time
+  std::sort(files.begin(), files.end(), std::greater<>());
+  size_t methods = 0;
+  for (const fs::path &path : files) {
+    try {
+      segments.push_back(std::make_unique<const BlameIndex>(path.string()));
+      methods += segments.back()->size();
+    } catch (const std::exception &e) {
+      // Deleted by a JVM that merged it meanwhile, or written by another agent version
+      logger->debug("Ignoring blame cache segment: {}", e.what());
+    }
+    mergedSegments.push_back(path);
+  }
+
+  cacheDirectory = directory;
+  cacheSizeLimit = sizeLimit;
+  logger->debug("Blame cache {}: {} segments, {} methods", directory, segments.size(), methods);
+}
+
+std::optional<std::vector<std::pair<size_t, std::string>>> PersistentBlameCache::find(const std::string &key,
+                                                                                      uint64_t codeHash) {
+  std::lock_guard<std::mutex> lock(cacheMutex);
+  for (const std::unique_ptr<const BlameIndex> &segment : segments) {
+    const BlameIndex::MethodRecord *method = segment->findMethod(key, codeHash);
+    if (method == nullptr) { continue; }
+
+    std::vector<std::pair<size_t, std::string>> sites = segment->getSites(*method);
+    // Methods used by this JVM are the last to be evicted
+    usedMethods.try_emplace(key, UsedMethod{codeHash, sites});
+    hits++;
+    return sites;
+  }
+  return std::nullopt;
+}
+
+void PersistentBlameCache::record(std::string key, uint64_t codeHash,
+                                  std::vector<std::pair<size_t, std::string>> sites) {
+  std::lock_guard<std::mutex> lock(cacheMutex);
+  if (cacheDirectory.empty()) { return; }
+  if (usedMethods.try_emplace(std::move(key), UsedMethod{codeHash, std::move(sites)}).second) { recorded++; }
+}
+
+void PersistentBlameCache::save() {
+  std::lock_guard<std::mutex> lock(cacheMutex);
+  // The loaded segments already hold everything this JVM knows
+  if (cacheDirectory.empty() || recorded == 0) { return; }
+
+  BlameIndex::Builder builder;
+  std::unordered_set<std::string_view> added;
+  size_t bytes = 0;
+  auto add = [&](std::string_view key, uint64_t codeHash, std::vector<std::pair<size_t, std::string>> sites) {
+    size_t methodBytes = persistedSize(key, sites);
+    if (bytes + methodBytes > cacheSizeLimit) { return; }
+    bytes += methodBytes;
+    added.insert(key);
+    builder.addMethod(std::string(key), codeHash, std::move(sites));
+  };
+
+  for (const auto &[key, method] : usedMethods) {
+    add(key, method.codeHash, method.sites);
+  }
+  for (const std::unique_ptr<const BlameIndex> &segment : segments) {
+    for (const BlameIndex::MethodRecord &method : *segment) {
+      std::string_view key = segment->getKey(method);
+      if (added.count(key) == 0) { add(key, method.codeHash, segment->getSites(method)); }
+    }
+  }
+
+  // Creation time first for sorting by age, random part against concurrent JVMs saving at the same time
+  auto now = std::chrono::system_clock::now().time_since_epoch();
+  fs::path path = fs::path(cacheDirectory) / "{:012x}-{:08x}{}"_format(
+      std::chrono::duration_cast<std::chrono::milliseconds>(now).count(), std::random_device()(), SEGMENT_EXTENSION);
+  try {
+    builder.write(path.string());
+  } catch (const std::exception &e) {
+    logger->warn("Failed to save blame cache: {}", e.what());
+    return;
+  }
+
+  // Unmapped first, mapped files can't be deleted on Windows. Segments another JVM still maps stay readable to it
+  added.clear();
+  segments.clear();
+  std::error_code error;
+  for (const fs::path &merged : mergedSegments) {
+    fs::remove(merged, error);
+  }
+  mergedSegments.clear();
+  recorded = 0;
+  logger->debug("Saved {} blame tables, {} bytes to {}", builder.size(), bytes, path.string());
+}
+
+size_t PersistentBlameCache::size() {
+  std::lock_guard<std::mutex> lock(cacheMutex);
+  size_t methods = 0;
+  for (const std::unique_ptr<const BlameIndex> &segment : segments) {
+    methods += segment->size();
+  }
+  return methods;
+}
+
+size_t PersistentBlameCache::getHits() {
+  std::lock_guard<std::mutex> lock(cacheMutex);
+  return hits;
+}
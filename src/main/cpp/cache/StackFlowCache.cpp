@@ -0,0 +1,35 @@
+#include "cache/StackFlowCache.h"
+
+#include <mutex>
+#include <unordered_map>
+
+static std::mutex cacheMutex;
+static std::unordered_map<jmethodID, std::shared_ptr<const StackAnalysis::Flow>> flows;
+
+std::shared_ptr<const StackAnalysis::Flow> StackFlowCache::get(
+    jmethodID method, const std::function<std::shared_ptr<const StackAnalysis::Flow>()> &analyze) {
+  {
+    std::lock_guard<std::mutex> lock(cacheMutex);
+    if (auto it = flows.find(method); it != flows.end()) { return it->second; }
+  }
+
+  // Analyzed without holding the lock, analyzing a method must not block NPEs in other methods
+  std::shared_ptr<const StackAnalysis::Flow> flow = analyze();
+
+  std::lock_guard<std::mutex> lock(cacheMutex);
+  return flows.emplace(method, std::move(flow)).first->second;
+}
+
+size_t StackFlowCache::evict(const std::unordered_set<jmethodID> &methods) {
+  std::lock_guard<std::mutex> lock(cacheMutex);
+  size_t evicted = 0;
+  for (jmethodID method : methods) {
+    evicted += flows.erase(method);
+  }
+  return evicted;
+}
+
+size_t StackFlowCache::size() {
+  std::lock_guard<std::mutex> lock(cacheMutex);
+  return flows.size();
+}
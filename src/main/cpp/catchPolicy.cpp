@@ -0,0 +1,50 @@
+#include "catchPolicy.h"
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <string_view>
+
+#include "cache/ClassRegistry.h"
+#include "cache/MethodCache.h"
+
+static std::atomic<size_t> skipped{0};
+
+/**
+ * Whether an entry of the swallowers option names the class or the method, e.g. a.B or a.B.m
+ */
+static bool matchesSwallower(std::string_view entry, const MethodInfo &info) {
+  if (entry == info.className) { return true; }
+
+  std::string_view methodName = info.methodName;
+  return entry.size() == info.className.size() + 1 + methodName.size() &&
+         entry.compare(0, info.className.size(), info.className) == 0 && entry[info.className.size()] == '.' &&
+         entry.substr(info.className.size() + 1) == methodName;
+}
+
+static bool isSwallower(jmethodID catchMethod) {
+  ClassRegistry::evictUnloaded();
+  std::shared_ptr<const MethodInfo> info = MethodCache::get(catchMethod);
+  for (const std::string &entry : AgentOptions::get().swallowers) {
+    if (matchesSwallower(entry, *info)) { return true; }
+  }
+  return false;
+}
+
+CatchAction CatchPolicy::evaluate(jmethodID method, jmethodID catchMethod) {
+  if (catchMethod == nullptr) { return CatchAction::Describe; }
+
+  CatchAction action = CatchAction::Describe;
+  if (!AgentOptions::get().swallowers.empty() && isSwallower(catchMethod)) {
+    action = CatchAction::Skip;
+  } else if (catchMethod == method) {
+    action = AgentOptions::get().localCatch;
+  }
+
+  if (action == CatchAction::Skip) { skipped.fetch_add(1, std::memory_order_relaxed); }
+  return action;
+}
+
+size_t CatchPolicy::getSkipped() {
+  return skipped.load(std::memory_order_relaxed);
+}
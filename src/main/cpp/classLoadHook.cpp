@@ -0,0 +1,45 @@
+#include "classLoadHook.h"
+
+#include <vector>
+#include <spdlog.h>
+
+#include "bytecode/ClassFile.h"
+#include "api/Jvmti.h"
+#include "cache/ClassImageStore.h"
+#include "cache/ClassRegistry.h"
+#include "npeHook.h"
+#include "options.h"
+#include "util.h"
+
+static auto logger = getLogger("ClassLoadHook");
+
+void JNICALL classFileLoadHook(jvmtiEnv *jvmti,
+                               JNIEnv *jni,
+                               jclass classBeingRedefined,
+                               jobject loader,
+                               const char *name,
+                               jobject protectionDomain,
+                               jint classDataLength,
+                               const unsigned char *classData,
+                               jint *newClassDataLength,
+                               unsigned char **newClassData) {
+  const AgentOptions &options = AgentOptions::get();
+
+  // Hidden classes have no name to look them up by
+  if (options.classImages && name != nullptr) {
+    try {
+      Jvmti::ensureInit(jvmti);
+      // Redeploys load the new classes right after the old loader is collected, free its images first
+      ClassRegistry::evictUnloaded();
+      ClassImageStore::record(loader, ClassFile(ByteView(classData, static_cast<size_t>(classDataLength))));
+    } catch (const std::exception &e) {
+      // The analysis falls back to JVMTI, not worth more than a debug message
+      logger->debug("Failed to record class image of {}: {}", name, e.what());
+    }
+  }
+
+  if (options.mode == BlameMode::Hook) {
+    npeHookClassFileLoadHook(jvmti, jni, classBeingRedefined, loader, name, protectionDomain, classDataLength,
+                             classData, newClassDataLength, newClassData);
+  }
+}
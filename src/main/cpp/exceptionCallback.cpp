@@ -4,10 +4,24 @@
 #include <sstream>
 #include <map>
 #include <iterator>
+#include <mutex>
 #include <spdlog.h>
 
 #include "bytecode/Method.h"
+#include "cache/BlameCache.h"
+#include "cache/BlameIndex.h"
+#include "cache/BlameTable.h"
+#include "cache/ConstPoolCache.h"
+#include "cache/ClassImageStore.h"
+#include "cache/ClassRegistry.h"
+#include "cache/IndexedMethodCache.h"
+#include "cache/MethodCache.h"
+#include "cache/PersistentBlameCache.h"
+#include "cache/StackFlowCache.h"
+#include "catchPolicy.h"
+#include "lazyMessages.h"
 #include "analyzer.h"
+#include "options.h"
 #include "util.h"
 #include "api/Jvmti.h"
 #include "api/Jni.h"
@@ -18,8 +32,79 @@ using fmt::literals::operator ""_format;
 
 static auto logger = getLogger("ExceptionCallback");
 
+// Resolved once so that the filter below never has to run Java code or look anything up by name
+static jclass npeClass = nullptr;
+static jfieldID detailMessageField = nullptr;
+static std::once_flag exceptionFilterInitialized;
+
+static thread_local bool analyzing = false;
+
+bool AnalysisGuard::isActive() {
+  return analyzing;
+}
+
+AnalysisGuard::AnalysisGuard(jthread thread) : thread(thread) {
+  if (thread != nullptr && AgentOptions::get().threadEvents) {
+    Jvmti::setExceptionEvents(thread, false);
+    eventsDisabled = true;
+  }
+  // Only set once nothing can throw anymore, the destructor would not reset it
+  analyzing = true;
+}
+
+AnalysisGuard::~AnalysisGuard() {
+  analyzing = false;
+  if (!eventsDisabled) { return; }
+
+  try {
+    Jvmti::setExceptionEvents(thread, true);
+  } catch (const std::exception &e) {
+    logger->error("Failed to enable exception events again: {}", e.what());
+  }
+}
+
+void initExceptionFilter(JNIEnv *jni) {
+  std::call_once(exceptionFilterInitialized, [jni]() {
+    jclass localNpeClass = jni->FindClass("java/lang/NullPointerException");
+    checkJniException(jni);
+    jclass throwableClass = jni->FindClass("java/lang/Throwable");
+    checkJniException(jni);
+
+    detailMessageField = jni->GetFieldID(throwableClass, "detailMessage", "Ljava/lang/String;");
+    checkJniException(jni);
+    npeClass = (jclass) jni->NewGlobalRef(localNpeClass);
+
+    jni->DeleteLocalRef(localNpeClass);
+    jni->DeleteLocalRef(throwableClass);
+  });
+}
+
+/**
+ * Check if the exception is a NullPointerException that has no message yet, i.e. one we should describe.
+ * Non-NPE exceptions are rejected by a single IsInstanceOf, no Java code is run and no strings are created.
+ */
+static bool isNPEWithoutMessage(JNIEnv *jni, jobject exception) {
+  if (!jni->IsInstanceOf(exception, npeClass)) { return false; }
+
+  // Subclasses are most likely thrown explicitly, only describe the exact class like the JVM does
+  jclass exceptionClass = jni->GetObjectClass(exception);
+  bool isNPE = jni->IsSameObject(exceptionClass, npeClass);
+  jni->DeleteLocalRef(exceptionClass);
+  if (!isNPE) { return false; }
+
+  jobject message = jni->GetObjectField(exception, detailMessageField);
+  if (message == nullptr) { return true; }
+
+  bool isEmpty = jni->GetStringUTFLength((jstring) message) == 0;
+  jni->DeleteLocalRef(message);
+  return isEmpty;
+}
+
 //TODO: Add info about exception table, e.g. bci | catchBci | op // comments
 void printBytecode(jlocation location, const ConstPool &constPool, const CodeAttribute &codeAttribute) {
+  // Printing resolves constant pool entries into new strings, skip it unless it will be logged
+  if (!logger->should_log(spdlog::level::debug)) { return; }
+
   InstructionPrintIterator iter(codeAttribute, constPool);
 
   logger->debug("Method instructions:");
@@ -66,7 +151,7 @@ bool shouldPrint(const CodeAttribute &codeAttribute, const string &methodName, c
      */
     for (; iter.getOffset() + 11 < codeAttribute.getSize(); iter++) {
 
-      logger->debug("Current opcode: {}", Constants::OpcodeMnemonic[std::get<1>(*iter)]);
+      logger->debug("Current opcode: {}", opcodeInfo(std::get<1>(*iter)).mnemonic);
 
       // Record current stack top via visitor?
 
@@ -97,21 +182,23 @@ bool shouldPrint(const CodeAttribute &codeAttribute, const string &methodName, c
   return true;
 }
 
-void printMethodParams(jthread thread) {
-  uint32_t frameCount = Jvmti::getFrameCount(thread);
+void printMethodParams(jthread thread, StackTrace &stack) {
+  if (!logger->should_log(spdlog::level::trace)) { return; }
 
-  for (uint32_t depth = 0; depth < frameCount; depth++) {
-    auto[methodId, location] = Jvmti::getFrameLocation(thread, depth);
+  for (uint32_t depth = 0; depth < stack.size(); depth++) {
+    auto[methodId, location] = stack.getFrame(depth);
 
-    if (Jvmti::isMethodNative(methodId)) continue;
+    // Deep stacks repeat the same methods, each costs a lookup instead of fetching names and tables again
+    std::shared_ptr<const MethodInfo> info = MethodCache::get(methodId);
+    const Method &method = info->method;
+    if (method.isNative()) continue;
 
-    uint8_t paramSlots = Jvmti::getMethodArgumentsSize(methodId);
-    LocalVariableTable variables = Jvmti::getLocalVariableTable(methodId);
-    Method method = Jvmti::toMethod(methodId);
+    // One object per parameter slot, plus the temporaries of the toString running for one of them
+    Jni::LocalFrame localRefs(info->argumentsSize + 2);
 
     std::ostringstream oss;
-    for (uint8_t slot = 0; slot < paramSlots; slot++) {
-      if (auto optLocalVar = variables.getEntry(slot); optLocalVar.has_value()) {
+    for (uint8_t slot = 0; slot < info->argumentsSize; slot++) {
+      if (auto optLocalVar = info->localVariables.getEntry(slot); optLocalVar.has_value()) {
         auto[name, type] = *optLocalVar;
         oss << name << "=" << Jvmti::localVariableToString(thread, depth, slot, type) << ", ";
         if (type == "J" || type == "D") slot++;
@@ -121,6 +208,199 @@ void printMethodParams(jthread thread) {
   }
 }
 
+// Everything the analyzer needs from a method
+struct MethodCode {
+  // Code read from JVMTI, codeAttribute views it in place
+  JvmtiBuffer bytecodes;
+  std::shared_ptr<const ConstPool> constPool;
+  LocalVariableTable localVariables;
+  CodeAttribute codeAttribute;
+  // Only known for classes with an image
+  std::shared_ptr<const StackMapTable> stackMap;
+  std::shared_ptr<const std::vector<uint16_t>> handlerPcs;
+};
+
+static MethodCode getMethodCode(jmethodID method, const MethodInfo &info) {
+  JvmtiBuffer bytecodes;
+  if (AgentOptions::get().classImages) {
+    std::shared_ptr<const ClassImage> image =
+        ClassImageStore::find(Jvmti::getClassLoader(Jvmti::getMethodDeclaringClass(method)), info.internalClassName);
+    const MethodImage *methodImage =
+        image == nullptr ? nullptr : image->findMethod(info.method.getMethodName(), info.method.getMethodSignature());
+    // An agent later in the load hook chain or a retransform may have changed the code, the location is in the
+    // loaded code
+    if (methodImage != nullptr) {
+      bytecodes = Jvmti::getBytecodes(method);
+      if (ByteVectorUtil::hash(bytecodes) != methodImage->codeHash) {
+        logger->debug("Class image of {}.{} differs from the loaded code", info.method.getClassName(),
+                      info.method.getMethodName());
+        methodImage = nullptr;
+      }
+    }
+    if (methodImage != nullptr) {
+      // Pointers into the image keep the whole image alive
+      return MethodCode{JvmtiBuffer(), std::shared_ptr<const ConstPool>(image, &image->getConstPool()),
+                        methodImage->localVariables, CodeAttribute(methodImage->code, methodImage->localVariables),
+                        std::shared_ptr<const StackMapTable>(image, &methodImage->stackMap),
+                        std::shared_ptr<const std::vector<uint16_t>>(image, &methodImage->handlerPcs)};
+    }
+  }
+
+  if (bytecodes.data() == nullptr) { bytecodes = Jvmti::getBytecodes(method); }
+  std::shared_ptr<const ConstPool> constPool = ConstPoolCache::get(Jvmti::getMethodDeclaringClass(method));
+  // Moving the buffer keeps its memory, the view stays valid
+  CodeAttribute codeAttribute{ByteView(bytecodes), info.localVariables};
+  return MethodCode{std::move(bytecodes), std::move(constPool), info.localVariables, std::move(codeAttribute), nullptr,
+                    nullptr};
+}
+
+// Tables persisted by another JVM or indexed offline are only reused if it matches
+static uint64_t hashMethodCode(const MethodCode &methodCode) {
+  return hashMethodCode(methodCode.codeAttribute, *methodCode.constPool, methodCode.localVariables);
+}
+
+static BlameTable buildBlameTable(jmethodID method, const MethodInfo &info) {
+  MethodCode methodCode = getMethodCode(method, info);
+  if (AgentOptions::get().cacheDir.empty()) {
+    return BlameTable(describeNPEInstructions(info.method, *methodCode.constPool, methodCode.codeAttribute,
+                                              methodCode.localVariables, methodCode.handlerPcs.get()));
+  }
+
+  string key = BlameIndex::methodKey(info.internalClassName, info.method.getMethodName(),
+                                     info.method.getMethodSignature());
+  uint64_t codeHash = hashMethodCode(methodCode);
+  if (auto persisted = PersistentBlameCache::find(key, codeHash); persisted.has_value()) {
+    return BlameTable(*persisted);
+  }
+
+  std::vector<std::pair<size_t, std::string>> sites = describeNPEInstructions(
+      info.method, *methodCode.constPool, methodCode.codeAttribute, methodCode.localVariables,
+      methodCode.handlerPcs.get());
+  BlameTable table(sites);
+  PersistentBlameCache::record(std::move(key), codeHash, std::move(sites));
+  return table;
+}
+
+/**
+ * Description from the index option, empty if the method is not in the index or was built from other code
+ */
+static std::optional<BlameCache::Description> findIndexed(const BlameIndex &index, jmethodID method,
+                                                          const MethodInfo &info, jlocation location) {
+  // The method is hashed on its first NPE, later sites only look up the record
+  const BlameIndex::MethodRecord *indexed = IndexedMethodCache::get(method, [&]() {
+    string key = BlameIndex::methodKey(info.internalClassName, info.method.getMethodName(),
+                                       info.method.getMethodSignature());
+    return index.findMethod(key, hashMethodCode(getMethodCode(method, info)));
+  });
+  if (indexed == nullptr) { return std::nullopt; }
+
+  // Like blame tables, the index has no entry for instructions that can't throw an NPE
+  std::optional<std::string_view> description = index.findSite(*indexed, static_cast<size_t>(location));
+  return description.has_value() ? BlameCache::Description(std::string(*description)) : BlameCache::Description();
+}
+
+/**
+ * Description of the instruction at location, empty if it can't throw an NPE
+ */
+static BlameCache::Description describeNPE(jmethodID method, const MethodInfo &info, jlocation location) {
+  std::string_view methodName = info.method.getMethodName();
+  std::string_view signature = info.method.getMethodSignature();
+
+  // Repeated NPEs at the same site only pay for a lookup, the bytecode is not parsed again
+  return BlameCache::instance().getOrCompute(method, location, [&]() {
+    if (const BlameIndex *index = BlameIndex::get(); index != nullptr) {
+      std::optional<BlameCache::Description> indexed = findIndexed(*index, method, info, location);
+      if (indexed.has_value()) { return *indexed; }
+    }
+
+    if (AgentOptions::get().methodTables) {
+      std::shared_ptr<const BlameTable> table = BlameTableCache::get(method, [&]() {
+        BlameTable built = buildBlameTable(method, info);
+        logger->debug("Blame table for {}{}: {} sites, {} bytes", methodName, signature, built.size(),
+                      built.memoryUsage());
+        return built;
+      });
+
+      // Instructions missing from the table can't throw an NPE, e.g. a constructor invocation
+      std::optional<std::string_view> description = table->find(static_cast<size_t>(location));
+      return description.has_value() ? BlameCache::Description(std::string(*description)) : BlameCache::Description();
+    }
+
+    MethodCode methodCode = getMethodCode(method, info);
+    const ConstPool &constPool = *methodCode.constPool;
+    const CodeAttribute &codeAttribute = methodCode.codeAttribute;
+
+    // The VM never throws at a constructor invocation, the NPE was created explicitly with `new NullPointerException()`
+    if (codeAttribute.getOpcode(location) == OpCodes::INVOKESPECIAL &&
+        Method::readFromCodeInvoke(codeAttribute, constPool, location).getMethodName() == "<init>") {
+      return BlameCache::Description();
+    }
+
+    logger->debug("java.lang.NullPointerException");
+    logger->debug("\tat {}.{}[{}]{}", info.method.getClassName(), methodName, location, signature);
+
+    printBytecode(location, constPool, codeAttribute);
+
+    // Other sites in the method replay their block from the same analysis
+    FlowProvider flow = [&]() {
+      return StackFlowCache::get(method, [&]() {
+        return StackAnalysis(codeAttribute, constPool, methodCode.handlerPcs.get()).getFlow();
+      });
+    };
+    return BlameCache::Description(describeNPEInstruction(info.method, constPool, codeAttribute,
+                                                          methodCode.localVariables, location,
+                                                          methodCode.stackMap.get(), flow));
+  });
+}
+
+/**
+ * Record of the method, after evicting its class if it was redefined since the record was fetched. A redefined method
+ * keeps its jmethodID, every cache keyed by it would otherwise go on describing the old code
+ */
+static std::shared_ptr<const MethodInfo> getCurrentMethod(jmethodID method) {
+  std::shared_ptr<const MethodInfo> info = MethodCache::get(method);
+  if (info->method.isNative() || ByteVectorUtil::hash(Jvmti::getBytecodes(method)) == info->codeHash) { return info; }
+
+  logger->debug("{}.{} was redefined, evicting its class", info->method.getClassName(), info->method.getMethodName());
+  ClassRegistry::evictRedefined(Jvmti::getMethodDeclaringClass(method));
+  return MethodCache::get(method);
+}
+
+BlameCache::Description describeNPE(jmethodID method, jlocation location) {
+  ClassRegistry::evictUnloaded();
+  return describeNPE(method, *getCurrentMethod(method), location);
+}
+
+void blameNPE(JNIEnv *jni, jthread thread, jobject exception, StackTrace &stack, jmethodID method, jlocation location,
+              uint32_t depth, bool lazy) {
+  // Before any lookup, the method may have a reused id of a method in an unloaded class
+  ClassRegistry::evictUnloaded();
+
+  std::shared_ptr<const MethodInfo> info = MethodCache::get(method);
+  if (info->method.isNative() || location == 0) { return; }
+
+  //JDK9+ compiles implicit Objects.requireNonNull before indy/inner constructor - analyze method in previous frame instead
+  if (info->method.getMethodName() == "requireNonNull" && info->internalClassName == "java/util/Objects") {
+    if (depth + 1 >= stack.size()) { return; }
+    std::tie(method, location) = stack.getFrame(depth + 1);
+    info = MethodCache::get(method);
+  }
+
+  // Most messages are never read, those are only described if getMessage is called
+  if (lazy && LazyMessages::isInstalled()) {
+    LazyMessages::record(exception, method, location);
+    printMethodParams(thread, stack);
+    return;
+  }
+
+  BlameCache::Description exceptionDetail = describeNPE(method, location);
+  if (!exceptionDetail.has_value()) { return; }
+
+  Jni::putField(exception, jniname("detailMessage"), jnisig("Ljava/lang/String;"), *exceptionDetail);
+
+  printMethodParams(thread, stack);
+}
+
 void JNICALL exceptionCallback(jvmtiEnv *jvmti,
                                JNIEnv *jni,
                                jthread thread,
@@ -130,46 +410,32 @@ void JNICALL exceptionCallback(jvmtiEnv *jvmti,
                                jmethodID catch_method,
                                jlocation catch_location) {
 
+  // Thrown by Java code run while this thread describes an NPE, rejected before anything else
+  if (AnalysisGuard::isActive()) { return; }
+
   try {
     Jvmti::ensureInit(jvmti);
     Jni::ensureInit(jni);
 
-    if (Jvmti::isMethodNative(method) || location == 0) { return; }
-
-    jclass exceptionClass = Jni::getClass(exception);
-    string exceptionClassName = Jni::invokeVirtual(exceptionClass, "getName", jnisig("()Ljava/lang/String;"));
-    string exceptionMessage = Jni::getField(exception, "detailMessage", jnisig("Ljava/lang/String;"));
-
-    if (exceptionClassName != "java.lang.NullPointerException") { return; }
+    // VMInit is not sent when attaching to a running VM, resolve lazily in that case
+    initExceptionFilter(jni);
 
     // If NPE has a message, e.g. when explicitly thrown, don't overwrite it
-    if (!exceptionMessage.empty()) { return; }
-
-    auto [methodName, signature] = Jvmti::getMethodNameAndSignature(method);
-    jclass declaringClass = Jvmti::getMethodDeclaringClass(method);
-    string declaringClassName = Jni::invokeVirtual(declaringClass, "getName", jnisig("()Ljava/lang/String;"));
-
-    //JDK9+ compiles implicit Objects.requireNonNull before indy/inner constructor - analyze method in previous frame instead
-    if (declaringClassName == "java.util.Objects" && methodName == "requireNonNull") {
-      std::tie(method, location) = Jvmti::getFrameLocation(thread, 1);
-      std::tie(methodName, signature) = Jvmti::getMethodNameAndSignature(method);
-    }
-
-    vector<uint8_t> methodBytecode = Jvmti::getBytecodes(method);
-    ConstPool constPool = Jvmti::getConstPool(Jvmti::getMethodDeclaringClass(method));
-    LocalVariableTable localVariables = Jvmti::getLocalVariableTable(method);
-    CodeAttribute codeAttribute(methodBytecode, localVariables);
+    if (!isNPEWithoutMessage(jni, exception)) { return; }
 
-    logger->debug("{}: {}", exceptionClassName, exceptionMessage);
-    logger->debug("\tat {}.{}[{}]{}", declaringClassName, methodName, location, signature);
+    // Swallowed NPEs never have their message read
+    CatchAction action = CatchPolicy::evaluate(method, catch_method);
+    if (action == CatchAction::Skip) { return; }
+    AnalysisGuard guard(thread);
 
-    printBytecode(location, constPool, codeAttribute);
+    // Other exceptions leave no refs behind, only the NPEs we describe pay for a frame
+    Jni::LocalFrame localRefs(CALLBACK_LOCAL_REFS);
 
-    string exceptionDetail = describeNPEInstruction(Jvmti::toMethod(method), constPool, codeAttribute, localVariables, location);
-    Jni::putField(exception, "detailMessage", jnisig("Ljava/lang/String;"), exceptionDetail);
-
-    printMethodParams(thread);
+    // The event has the throwing frame, the rest of the stack is only walked if needed
+    StackTrace stack(thread);
+    blameNPE(jni, thread, exception, stack, method, location, 0,
+             action == CatchAction::Lazy || AgentOptions::get().lazyMessages);
   } catch (const std::exception &e) {
     logger->error("Failed to run exception callback: {}", e.what());
   }
-}
\ No newline at end of file
+}
@@ -0,0 +1,152 @@
+#include "lazyMessages.h"
+
+#include <atomic>
+#include <mutex>
+#include <optional>
+#include <vector>
+#include <spdlog.h>
+
+#include "exceptionCallback.h"
+#include "util.h"
+#include "api/Jni.h"
+#include "api/Jvmti.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <dlfcn.h>
+#endif
+
+static auto logger = getLogger("LazyMessages");
+
+struct NPERecord {
+  jmethodID method;
+  jlocation location;
+};
+
+// The JVM's own implementation of getExtendedNPEMessage, which the native binding replaces
+using ExtendedNPEMessage = jstring (JNICALL *)(JNIEnv *, jobject);
+
+static jvmtiEnv *lazyJvmti = nullptr;
+static ExtendedNPEMessage jvmExtendedMessage = nullptr;
+static std::atomic<bool> installed{false};
+
+// Never held across JVM calls, ObjectFree can always take it
+static std::mutex recordsMutex;
+// Tag minus RECORD_TAG_BASE is the index
+static std::vector<NPERecord> records;
+static std::vector<size_t> freeRecords;
+
+static std::atomic<size_t> recorded{0};
+static std::atomic<size_t> described{0};
+
+static std::optional<NPERecord> findRecord(jlong tag) {
+  if (tag < LazyMessages::RECORD_TAG_BASE) { return std::nullopt; }
+
+  std::lock_guard<std::mutex> lock(recordsMutex);
+  size_t index = static_cast<size_t>(tag - LazyMessages::RECORD_TAG_BASE);
+  return index < records.size() ? std::optional<NPERecord>(records[index]) : std::nullopt;
+}
+
+/**
+ * Exported by libjvm, null if the JVM was loaded without exposing its symbols
+ */
+static ExtendedNPEMessage findJvmExtendedMessage() {
+#ifdef _WIN32
+  HMODULE jvm = GetModuleHandleA("jvm.dll");
+  return jvm == nullptr ? nullptr
+                        : reinterpret_cast<ExtendedNPEMessage>(GetProcAddress(jvm, "JVM_GetExtendedNPEMessage"));
+#else
+  return reinterpret_cast<ExtendedNPEMessage>(dlsym(RTLD_DEFAULT, "JVM_GetExtendedNPEMessage"));
+#endif
+}
+
+/**
+ * Replaces the JVM's helpful NPE message, only called by getMessage while the NPE has no message
+ */
+static jstring JNICALL getExtendedNPEMessage(JNIEnv *jni, jobject npe) {
+  try {
+    Jvmti::ensureInit(lazyJvmti);
+    Jni::ensureInit(jni);
+
+    // Not recorded, e.g. thrown before VMInit, skipped by the catch policy or on a thread without exception events.
+    // The JVM describes it as if the agent was not there
+    std::optional<NPERecord> record = findRecord(Jvmti::getTag(npe));
+    if (!record.has_value()) { return jvmExtendedMessage != nullptr ? jvmExtendedMessage(jni, npe) : nullptr; }
+
+    std::optional<std::string> description = describeNPE(record->method, record->location);
+    described.fetch_add(1, std::memory_order_relaxed);
+    return description.has_value() ? jni->NewStringUTF(description->c_str()) : nullptr;
+  } catch (const std::exception &e) {
+    logger->error("Failed to describe NPE: {}", e.what());
+    return nullptr;
+  }
+}
+
+bool LazyMessages::install(jvmtiEnv *jvmti, JNIEnv *jni) {
+  lazyJvmti = jvmti;
+
+  jclass npeClass = jni->FindClass("java/lang/NullPointerException");
+  checkJniException(jni);
+  jmethodID extendedMessage = jni->GetMethodID(npeClass, "getExtendedNPEMessage", "()Ljava/lang/String;");
+  if (extendedMessage == nullptr) {
+    jni->ExceptionClear();
+    jni->DeleteLocalRef(npeClass);
+    return false;
+  }
+
+  JNINativeMethod nativeMethod{const_cast<char *>("getExtendedNPEMessage"),
+                               const_cast<char *>("()Ljava/lang/String;"), (void *) &getExtendedNPEMessage};
+  jni->RegisterNatives(npeClass, &nativeMethod, 1);
+  jni->DeleteLocalRef(npeClass);
+  checkJniException(jni);
+
+  jvmExtendedMessage = findJvmExtendedMessage();
+  if (jvmExtendedMessage == nullptr) {
+    logger->warn("JVM_GetExtendedNPEMessage not found, NPEs the agent did not record have no message");
+  }
+
+  installed.store(true, std::memory_order_release);
+  logger->info("NullPointerException messages are described when read");
+  return true;
+}
+
+bool LazyMessages::isInstalled() {
+  return installed.load(std::memory_order_acquire);
+}
+
+void LazyMessages::record(jobject exception, jmethodID method, jlocation location) {
+  // Thrown again, e.g. rethrown from a catch block. The first throw is the one that was null
+  if (Jvmti::getTag(exception) != 0) { return; }
+
+  size_t index;
+  {
+    std::lock_guard<std::mutex> lock(recordsMutex);
+    if (freeRecords.empty()) {
+      index = records.size();
+      records.push_back(NPERecord{method, location});
+    } else {
+      index = freeRecords.back();
+      freeRecords.pop_back();
+      records[index] = NPERecord{method, location};
+    }
+  }
+  Jvmti::setTag(exception, RECORD_TAG_BASE + static_cast<jlong>(index));
+  recorded.fetch_add(1, std::memory_order_relaxed);
+}
+
+bool LazyMessages::release(jlong tag) {
+  if (tag < RECORD_TAG_BASE) { return false; }
+
+  std::lock_guard<std::mutex> lock(recordsMutex);
+  freeRecords.push_back(static_cast<size_t>(tag - RECORD_TAG_BASE));
+  return true;
+}
+
+size_t LazyMessages::getRecorded() {
+  return recorded.load(std::memory_order_relaxed);
+}
+
+size_t LazyMessages::getDescribed() {
+  return described.load(std::memory_order_relaxed);
+}
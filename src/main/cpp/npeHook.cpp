@@ -0,0 +1,288 @@
+#include "npeHook.h"
+
+#include <cstring>
+#include <atomic>
+#include <vector>
+#include <spdlog.h>
+
+#include "bytecode/ClassFile.h"
+#include "bytecode/CodeAttribute.h"
+#include "exceptionCallback.h"
+#include "exceptions.h"
+#include "options.h"
+#include "util.h"
+#include "api/Jvmti.h"
+#include "api/Jni.h"
+
+using fmt::literals::operator ""_format;
+
+static auto logger = getLogger("NpeHook");
+
+// Defined in java.lang so that java.base can link against it without module reads edges on JDK9+
+static const char *HOOK_CLASS = "java/lang/NpeBlameHook";
+static const char *HOOK_METHOD = "onNpeConstructed";
+static const char *HOOK_SIGNATURE = "(Ljava/lang/Throwable;)V";
+
+static jvmtiEnv *hookJvmti = nullptr;
+static std::atomic<bool> npeTransformed{false};
+
+/**
+ * public final class java.lang.NpeBlameHook {
+ *   public static native void onNpeConstructed(Throwable t);
+ * }
+ */
+static std::vector<uint8_t> hookClassBytes() {
+  std::vector<uint8_t> bytes;
+  ByteVectorUtil::writeuint32(bytes, ClassFile::MAGIC);
+  ByteVectorUtil::writeuint16(bytes, 0);  // minor
+  ByteVectorUtil::writeuint16(bytes, 52); // major, Java 8
+
+  ByteVectorUtil::writeuint16(bytes, 7);  // constant_pool_count
+  ByteVectorUtil::writeuint8(bytes, CpInfo::Utf8);  // #1
+  ByteVectorUtil::writeutf8(bytes, HOOK_CLASS);
+  ByteVectorUtil::writeuint8(bytes, CpInfo::Class); // #2
+  ByteVectorUtil::writeuint16(bytes, 1);
+  ByteVectorUtil::writeuint8(bytes, CpInfo::Utf8);  // #3
+  ByteVectorUtil::writeutf8(bytes, "java/lang/Object");
+  ByteVectorUtil::writeuint8(bytes, CpInfo::Class); // #4
+  ByteVectorUtil::writeuint16(bytes, 3);
+  ByteVectorUtil::writeuint8(bytes, CpInfo::Utf8);  // #5
+  ByteVectorUtil::writeutf8(bytes, HOOK_METHOD);
+  ByteVectorUtil::writeuint8(bytes, CpInfo::Utf8);  // #6
+  ByteVectorUtil::writeutf8(bytes, HOOK_SIGNATURE);
+
+  ByteVectorUtil::writeuint16(bytes, Modifier::PUBLIC | Modifier::FINAL | 0x0020); // ACC_SUPER
+  ByteVectorUtil::writeuint16(bytes, 2); // this_class
+  ByteVectorUtil::writeuint16(bytes, 4); // super_class
+  ByteVectorUtil::writeuint16(bytes, 0); // interfaces_count
+  ByteVectorUtil::writeuint16(bytes, 0); // fields_count
+
+  ByteVectorUtil::writeuint16(bytes, 1); // methods_count
+  ByteVectorUtil::writeuint16(bytes, Modifier::PUBLIC | Modifier::STATIC | Modifier::NATIVE);
+  ByteVectorUtil::writeuint16(bytes, 5);
+  ByteVectorUtil::writeuint16(bytes, 6);
+  ByteVectorUtil::writeuint16(bytes, 0); // attributes_count
+
+  ByteVectorUtil::writeuint16(bytes, 0); // attributes_count
+  return bytes;
+}
+
+static bool isBranch(uint8_t opCode) {
+  return opCode >= OpCodes::IFEQ && opCode <= OpCodes::LOOKUPSWITCH ||
+         opCode >= OpCodes::IFNULL && opCode <= OpCodes::JSR_W;
+}
+
+/**
+ * Rewrite code of NullPointerException() to call NpeBlameHook.onNpeConstructed(this) before returning.
+ * Only straight-line code is supported so that no jump offsets or stack map frames need to be adjusted,
+ * the constructor is just a super() call in every JDK version.
+ */
+static std::vector<uint8_t> transformNpe(const ClassFile &classFile) {
+  ByteView bytes = classFile.getBytes();
+  const ConstPool &constPool = classFile.getConstPool();
+
+  const MemberInfo *constructor = classFile.findMethod("<init>", "()V");
+  if (constructor == nullptr) { throw InvalidArgument("NullPointerException() constructor not found"); }
+  const AttributeInfo *codeAttr = classFile.findAttribute(constructor->attributes, "Code");
+  if (codeAttr == nullptr) { throw InvalidArgument("NullPointerException() has no Code attribute"); }
+
+  size_t pos = codeAttr->offset + 6;
+  uint16_t maxStack = ByteVectorUtil::readuint16(bytes, pos);
+  uint16_t maxLocals = ByteVectorUtil::readuint16(bytes, pos + 2);
+  uint32_t codeLength = ByteVectorUtil::readuint32(bytes, pos + 4);
+  pos += 8;
+  CodeAttribute code(bytes.subview(pos, codeLength));
+  pos += codeLength;
+  uint16_t exceptionTableLength = ByteVectorUtil::readuint16(bytes, pos);
+  pos += 2 + 8 * exceptionTableLength;
+
+  if (exceptionTableLength != 0) { throw InvalidArgument("NullPointerException() has an exception table"); }
+
+  std::vector<size_t> returns;
+  for (size_t off : code.getInstructions()) {
+    uint8_t opCode = code.getOpcode(off);
+    if (isBranch(opCode)) {
+      throw InvalidArgument("NullPointerException() has branching instruction {}"_format(opcodeInfo(opCode).mnemonic));
+    }
+    if (opCode == OpCodes::RETURN) { returns.push_back(off); }
+  }
+
+  // aload_0, invokestatic #hookMethodRef
+  const uint8_t hookLength = 4;
+  auto mapPc = [&](size_t pc) -> size_t {
+    size_t shift = 0;
+    for (size_t ret : returns) {
+      if (ret < pc) { shift += hookLength; }
+    }
+    return pc + shift;
+  };
+
+  // New entries go to the end of constant pool, indexes stay valid
+  uint16_t cpCount = classFile.getConstPoolCount();
+  uint16_t hookMethodRef = cpCount + 5;
+
+  std::vector<uint8_t> newCode;
+  for (size_t off : code.getInstructions()) {
+    if (code.getOpcode(off) == OpCodes::RETURN) {
+      ByteVectorUtil::writeuint8(newCode, OpCodes::ALOAD_0);
+      ByteVectorUtil::writeuint8(newCode, OpCodes::INVOKESTATIC);
+      ByteVectorUtil::writeuint16(newCode, hookMethodRef);
+    }
+    newCode.insert(newCode.end(), code.getCode().begin() + off, code.getCode().begin() + off + code.getInstructionLength(off));
+  }
+
+  std::vector<uint8_t> codeInfo;
+  ByteVectorUtil::writeuint16(codeInfo, std::max<uint16_t>(maxStack, 1));
+  ByteVectorUtil::writeuint16(codeInfo, maxLocals);
+  ByteVectorUtil::writeuint32(codeInfo, static_cast<uint32_t>(newCode.size()));
+  codeInfo.insert(codeInfo.end(), newCode.begin(), newCode.end());
+  ByteVectorUtil::writeuint16(codeInfo, 0); // exception_table_length
+
+  uint16_t attributesCount = ByteVectorUtil::readuint16(bytes, pos);
+  ByteVectorUtil::writeuint16(codeInfo, attributesCount);
+  pos += 2;
+  for (uint16_t i = 0; i < attributesCount; i++) {
+    uint16_t nameIndex = ByteVectorUtil::readuint16(bytes, pos);
+    uint32_t length = ByteVectorUtil::readuint32(bytes, pos + 2);
+    std::string_view name = constPool.getUtf8(nameIndex);
+    size_t info = pos + 6;
+
+    ByteVectorUtil::writeuint16(codeInfo, nameIndex);
+    ByteVectorUtil::writeuint32(codeInfo, length);
+    if (name == "LineNumberTable") {
+      uint16_t count = ByteVectorUtil::readuint16(bytes, info);
+      ByteVectorUtil::writeuint16(codeInfo, count);
+      for (uint16_t entry = 0; entry < count; entry++) {
+        size_t entryPos = info + 2 + entry * 4;
+        ByteVectorUtil::writeuint16(codeInfo, mapPc(ByteVectorUtil::readuint16(bytes, entryPos)));
+        ByteVectorUtil::writeuint16(codeInfo, ByteVectorUtil::readuint16(bytes, entryPos + 2));
+      }
+    } else if (name == "LocalVariableTable" || name == "LocalVariableTypeTable") {
+      uint16_t count = ByteVectorUtil::readuint16(bytes, info);
+      ByteVectorUtil::writeuint16(codeInfo, count);
+      for (uint16_t entry = 0; entry < count; entry++) {
+        size_t entryPos = info + 2 + entry * 10;
+        uint16_t startPc = ByteVectorUtil::readuint16(bytes, entryPos);
+        uint16_t length = ByteVectorUtil::readuint16(bytes, entryPos + 2);
+        ByteVectorUtil::writeuint16(codeInfo, mapPc(startPc));
+        ByteVectorUtil::writeuint16(codeInfo, mapPc(startPc + length) - mapPc(startPc));
+        codeInfo.insert(codeInfo.end(), bytes.begin() + entryPos + 4, bytes.begin() + entryPos + 10);
+      }
+    } else if (name == "StackMapTable") {
+      throw InvalidArgument("NullPointerException() has a StackMapTable");
+    } else {
+      codeInfo.insert(codeInfo.end(), bytes.begin() + info, bytes.begin() + info + length);
+    }
+    pos = info + length;
+  }
+
+  std::vector<uint8_t> transformed;
+  transformed.reserve(bytes.size() + codeInfo.size() + 128);
+  transformed.insert(transformed.end(), bytes.begin(), bytes.begin() + 8);
+  ByteVectorUtil::writeuint16(transformed, cpCount + 6);
+  transformed.insert(transformed.end(), bytes.begin() + 10, bytes.begin() + classFile.getConstPoolEnd());
+  ByteVectorUtil::writeuint8(transformed, CpInfo::Utf8);        // cpCount + 0
+  ByteVectorUtil::writeutf8(transformed, HOOK_CLASS);
+  ByteVectorUtil::writeuint8(transformed, CpInfo::Class);       // cpCount + 1
+  ByteVectorUtil::writeuint16(transformed, cpCount);
+  ByteVectorUtil::writeuint8(transformed, CpInfo::Utf8);        // cpCount + 2
+  ByteVectorUtil::writeutf8(transformed, HOOK_METHOD);
+  ByteVectorUtil::writeuint8(transformed, CpInfo::Utf8);        // cpCount + 3
+  ByteVectorUtil::writeutf8(transformed, HOOK_SIGNATURE);
+  ByteVectorUtil::writeuint8(transformed, CpInfo::NameAndType); // cpCount + 4
+  ByteVectorUtil::writeuint16(transformed, cpCount + 2);
+  ByteVectorUtil::writeuint16(transformed, cpCount + 3);
+  ByteVectorUtil::writeuint8(transformed, CpInfo::Methodref);   // cpCount + 5
+  ByteVectorUtil::writeuint16(transformed, cpCount + 1);
+  ByteVectorUtil::writeuint16(transformed, cpCount + 4);
+
+  // Everything between constant pool and the Code attribute, then the Code attribute with its new length
+  transformed.insert(transformed.end(), bytes.begin() + classFile.getConstPoolEnd(), bytes.begin() + codeAttr->offset);
+  ByteVectorUtil::writeuint16(transformed, codeAttr->nameIndex);
+  ByteVectorUtil::writeuint32(transformed, static_cast<uint32_t>(codeInfo.size()));
+  transformed.insert(transformed.end(), codeInfo.begin(), codeInfo.end());
+  transformed.insert(transformed.end(), bytes.begin() + codeAttr->offset + 6 + codeAttr->length, bytes.end());
+
+  return transformed;
+}
+
+void JNICALL npeHookClassFileLoadHook(jvmtiEnv *jvmti,
+                                      JNIEnv *jni,
+                                      jclass classBeingRedefined,
+                                      jobject loader,
+                                      const char *name,
+                                      jobject protectionDomain,
+                                      jint classDataLength,
+                                      const unsigned char *classData,
+                                      jint *newClassDataLength,
+                                      unsigned char **newClassData) {
+  if (loader != nullptr || name == nullptr || std::strcmp(name, "java/lang/NullPointerException") != 0) { return; }
+
+  try {
+    ClassFile classFile{ByteView(classData, static_cast<size_t>(classDataLength))};
+    std::vector<uint8_t> transformed = transformNpe(classFile);
+
+    unsigned char *transformedData = nullptr;
+    jvmtiError err = jvmti->Allocate(static_cast<jlong>(transformed.size()), &transformedData);
+    if (err != JVMTI_ERROR_NONE) { throw JvmtiError("Failed to allocate {} bytes"_format(transformed.size())); }
+    std::memcpy(transformedData, transformed.data(), transformed.size());
+
+    *newClassData = transformedData;
+    *newClassDataLength = static_cast<jint>(transformed.size());
+    npeTransformed = true;
+    logger->debug("Instrumented NullPointerException()");
+  } catch (const std::exception &e) {
+    logger->error("Failed to instrument NullPointerException: {}", e.what());
+  }
+}
+
+static void JNICALL onNpeConstructed(JNIEnv *jni, jclass hookClass, jobject npe) {
+  // Created by Java code run while this thread describes an NPE
+  if (AnalysisGuard::isActive()) { return; }
+
+  try {
+    Jvmti::ensureInit(hookJvmti);
+    Jni::ensureInit(jni);
+    AnalysisGuard guard(nullptr);
+    Jni::LocalFrame localRefs(CALLBACK_LOCAL_REFS);
+
+    // Frame 0 is this native method and 1 the instrumented constructor, the frame that created the NPE is next
+    const uint32_t depth = 2;
+    StackTrace stack(nullptr);
+    if (stack.size() <= depth) { return; }
+
+    auto[method, location] = stack.getFrame(depth);
+    // The constructor doesn't know where the NPE will be caught, only the lazy option applies
+    blameNPE(jni, nullptr, npe, stack, method, location, depth, AgentOptions::get().lazyMessages);
+  } catch (const std::exception &e) {
+    logger->error("Failed to run NPE constructor hook: {}", e.what());
+  }
+}
+
+void installNpeHook(jvmtiEnv *jvmti, JNIEnv *jni) {
+  hookJvmti = jvmti;
+
+  std::vector<uint8_t> classBytes = hookClassBytes();
+  jclass hookClass = jni->DefineClass(HOOK_CLASS, nullptr, reinterpret_cast<const jbyte *>(classBytes.data()),
+                                      static_cast<jsize>(classBytes.size()));
+  checkJniException(jni);
+
+  JNINativeMethod hookMethod{const_cast<char *>(HOOK_METHOD), const_cast<char *>(HOOK_SIGNATURE), (void *) &onNpeConstructed};
+  jni->RegisterNatives(hookClass, &hookMethod, 1);
+  checkJniException(jni);
+  jni->DeleteLocalRef(hookClass);
+
+  jclass npeClass = jni->FindClass("java/lang/NullPointerException");
+  checkJniException(jni);
+
+  jvmtiError err = jvmti->SetEventNotificationMode(JVMTI_ENABLE, JVMTI_EVENT_CLASS_FILE_LOAD_HOOK, nullptr);
+  if (err == JVMTI_ERROR_NONE) {
+    err = jvmti->RetransformClasses(1, &npeClass);
+  }
+  jni->DeleteLocalRef(npeClass);
+
+  if (err != JVMTI_ERROR_NONE || !npeTransformed) {
+    throw JvmtiError("Retransforming NullPointerException failed with error {}"_format(err));
+  }
+  logger->info("NullPointerException constructor hook installed");
+}
@@ -4,6 +4,18 @@
 #include <jvmti.h>
 #include <spdlog.h>
 
+#include "options.h"
+#include "cache/BlameCache.h"
+#include "cache/BlameIndex.h"
+#include "cache/BlameTable.h"
+#include "cache/ClassImageStore.h"
+#include "cache/ClassRegistry.h"
+#include "cache/IndexedMethodCache.h"
+#include "cache/MethodCache.h"
+#include "cache/PersistentBlameCache.h"
+#include "cache/StackFlowCache.h"
+#include "catchPolicy.h"
+#include "lazyMessages.h"
 #include "util.h"
 #include "api/Jvmti.h"
 
@@ -16,20 +28,44 @@ JNIEXPORT jint JNICALL Agent_OnAttach(JavaVM *vm, char *options, void *reserved)
 }
 
 JNIEXPORT jint JNICALL Agent_OnLoad(JavaVM *vm, char *options, void *reserved) {
-  std::string_view opts = options == nullptr ? "" : std::string(options);
-  if (opts == "debug") {
-    spdlog::set_level(spdlog::level::debug);
-  } else if (opts == "trace") {
-    spdlog::set_level(spdlog::level::trace);
-  }
+  AgentOptions::set(AgentOptions::parse(options == nullptr ? "" : options));
+  spdlog::set_level(AgentOptions::get().logLevel);
 
   spdlog::set_pattern("%Y-%m-%d %T.%e %L [%n] %v");
 
-  Jvmti::init(vm);
+  if (!AgentOptions::get().index.empty()) {
+    BlameIndex::load(AgentOptions::get().index);
+  }
+  if (!AgentOptions::get().cacheDir.empty()) {
+    PersistentBlameCache::open(AgentOptions::get().cacheDir, AgentOptions::get().cacheDirSize);
+  }
+
+  try {
+    Jvmti::init(vm);
+  } catch (const std::exception &e) {
+    logger->error("Failed to load agent: {}", e.what());
+    return JNI_ERR;
+  }
 
   return JNI_OK;
 }
 
 JNIEXPORT void JNICALL Agent_OnUnload(JavaVM *vm) {
+  PersistentBlameCache::save();
+
+  BlameCache &cache = BlameCache::instance();
+  logger->debug("Blame cache: {} hits, {} misses, {} sites", cache.getHits(), cache.getMisses(), cache.size());
+  logger->debug("Blame tables: {} methods, {} bytes", BlameTableCache::size(), BlameTableCache::memoryUsage());
+  logger->debug("Method records: {} methods", MethodCache::size());
+  logger->debug("Stack flows: {} methods", StackFlowCache::size());
+  logger->debug("Indexed method records: {} methods", IndexedMethodCache::size());
+  logger->debug("Class images: {} classes, {} of {} bytes, {} rejected", ClassImageStore::size(),
+                ClassImageStore::memoryUsage(), ClassImageStore::memoryLimit(), ClassImageStore::rejected());
+  logger->debug("Class handles: {} classes, {} entries of unloaded classes evicted", ClassRegistry::size(),
+                ClassRegistry::evicted());
+  logger->debug("Persistent blame cache: {} hits", PersistentBlameCache::getHits());
+  logger->debug("Lazy messages: {} NPEs recorded, {} messages read", LazyMessages::getRecorded(),
+                LazyMessages::getDescribed());
+  logger->debug("Catch policy: {} NPEs skipped", CatchPolicy::getSkipped());
 }
 
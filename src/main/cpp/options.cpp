@@ -0,0 +1,79 @@
+#include "options.h"
+
+#include <string>
+
+#include "util.h"
+
+static auto logger = getLogger("Options");
+
+static AgentOptions currentOptions;
+
+AgentOptions AgentOptions::parse(std::string_view options) {
+  AgentOptions parsed;
+
+  while (!options.empty()) {
+    size_t end = options.find(',');
+    std::string_view option = options.substr(0, end);
+    options = end == std::string_view::npos ? "" : options.substr(end + 1);
+
+    size_t eq = option.find('=');
+    std::string_view key = option.substr(0, eq);
+    std::string_view value = eq == std::string_view::npos ? "" : option.substr(eq + 1);
+
+    if (key == "debug") {
+      parsed.logLevel = spdlog::level::debug;
+    } else if (key == "trace") {
+      parsed.logLevel = spdlog::level::trace;
+    } else if (key == "mode" && value == "event") {
+      parsed.mode = BlameMode::Event;
+    } else if (key == "mode" && value == "hook") {
+      parsed.mode = BlameMode::Hook;
+    } else if (key == "cacheSize" && !value.empty() &&
+               value.find_first_not_of("0123456789") == std::string_view::npos) {
+      parsed.cacheSize = std::stoul(std::string(value));
+    } else if (key == "methodTables") {
+      parsed.methodTables = true;
+    } else if (key == "classImages") {
+      parsed.classImages = true;
+    } else if (key == "classImageMemory" && !value.empty() &&
+               value.find_first_not_of("0123456789") == std::string_view::npos) {
+      parsed.classImageMemory = std::stoul(std::string(value)) * 1024 * 1024;
+    } else if (key == "index" && !value.empty()) {
+      parsed.index = std::string(value);
+    } else if (key == "cacheDir" && !value.empty()) {
+      parsed.cacheDir = std::string(value);
+      parsed.methodTables = true;
+    } else if (key == "cacheDirSize" && !value.empty() &&
+               value.find_first_not_of("0123456789") == std::string_view::npos) {
+      parsed.cacheDirSize = std::stoul(std::string(value)) * 1024 * 1024;
+    } else if (key == "lazy") {
+      parsed.lazyMessages = true;
+    } else if (key == "swallowers" && !value.empty()) {
+      while (!value.empty()) {
+        size_t separator = value.find(';');
+        if (separator != 0) { parsed.swallowers.emplace_back(value.substr(0, separator)); }
+        value = separator == std::string_view::npos ? "" : value.substr(separator + 1);
+      }
+    } else if (key == "localCatch" && value == "describe") {
+      parsed.localCatch = CatchAction::Describe;
+    } else if (key == "localCatch" && value == "lazy") {
+      parsed.localCatch = CatchAction::Lazy;
+    } else if (key == "localCatch" && value == "skip") {
+      parsed.localCatch = CatchAction::Skip;
+    } else if (key == "threadEvents") {
+      parsed.threadEvents = true;
+    } else if (!key.empty()) {
+      logger->warn("Ignoring unknown agent option '{}'", std::string(option));
+    }
+  }
+
+  return parsed;
+}
+
+void AgentOptions::set(const AgentOptions &options) {
+  currentOptions = options;
+}
+
+const AgentOptions &AgentOptions::get() {
+  return currentOptions;
+}
@@ -207,5 +207,5 @@ uint16_t opcodeSlot(uint8_t opCode) {
     if (val != 9) { return val; }
   }
 
-  throw std::invalid_argument("Opcode is not a valid 1 byte load/store: {}"_format(Constants::OpcodeMnemonic[opCode]));
+  throw std::invalid_argument("Opcode is not a valid 1 byte load/store: {}"_format(opcodeInfo(opCode).mnemonic));
 }
@@ -1,8 +1,40 @@
 #pragma once
 
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
 #include "bytecode/CodeAttribute.h"
 #include "bytecode/Method.h"
+#include "bytecode/StackAnalysis.h"
+#include "bytecode/StackMapTable.h"
+
+/**
+ * Flow of the whole method, e.g. cached from an earlier NPE in it. Only called if the stack map can't answer
+ */
+using FlowProvider = std::function<std::shared_ptr<const StackAnalysis::Flow>()>;
+
+/**
+ * Describe the source of the reference stackExcess slots below the top of the stack at location.
+ * With the method's stackMap, only the code after the closest frame is replayed if the reference was pushed there.
+ * Otherwise the method is analyzed, by flow if given.
+ */
+std::string traceDetailedCause(const Method &currentFrameMethod, const ConstPool &cp, const CodeAttribute &code, const LocalVariableTable &vars, size_t location, int stackExcess, const StackMapTable *stackMap = nullptr, const FlowProvider &flow = nullptr);
 
-std::string traceDetailedCause(const ConstPool &cp, const CodeAttribute &code, const LocalVariableTable &vars, size_t location, size_t stackExcess);
+std::string describeNPEInstruction(const Method &currentFrameMethod, const ConstPool &cp, const CodeAttribute &code, const LocalVariableTable &vars, size_t location, const StackMapTable *stackMap = nullptr, const FlowProvider &flow = nullptr);
 
-std::string describeNPEInstruction(const Method &currentFrameMethod, const ConstPool &cp, const CodeAttribute &code, const LocalVariableTable &vars, size_t location);
\ No newline at end of file
+/**
+ * Describe every instruction in the method that can throw an NPE, using one stack analysis for all of them
+ * @param handlerPcs handler offsets of the exception table, null if the table is not known
+ * @return location and description of each instruction, ordered by location
+ */
+std::vector<std::pair<size_t, std::string>> describeNPEInstructions(const Method &currentFrameMethod, const ConstPool &cp, const CodeAttribute &code, const LocalVariableTable &vars, const std::vector<uint16_t> *handlerPcs = nullptr);
+/**
+ * Hash of everything the descriptions of a method depend on: its code, the constant pool entries the code refers to
+ * and its local variables. Entries are hashed resolved, so a class file and the pool JVMTI reconstitutes for it hash
+ * the same even where their bytes differ
+ */
+uint64_t hashMethodCode(const CodeAttribute &code, const ConstPool &cp, const LocalVariableTable &vars);
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <atomic>
 #include <string>
 #include <utility>
 #include <assert.h>
@@ -260,6 +261,7 @@ struct SignatureChecker {
 };
 
 #define jnisig(x) typestring_is(x){}
+#define jniname(x) typestring_is(x){}
 
 class Jni {
 
@@ -293,14 +295,145 @@ class Jni {
     }
   };
 
+  /**
+   * Method or field id of one call site, resolved on first use instead of on every call. The class it was resolved
+   * in is held by a weak reference so that it can still be unloaded, the id is resolved again once it was.
+   */
+  template<typename Id>
+  class MemberSlot {
+    struct Binding {
+      jweak klass;
+      Id id;
+    };
+
+    std::atomic<const Binding *> binding{nullptr};
+
+  public:
+    /**
+     * @return null unless object is an instance of the bound class
+     */
+    Id findFor(jobject object) const {
+      const Binding *bound = binding.load(std::memory_order_acquire);
+      if (bound == nullptr) { return nullptr; }
+
+      // The local reference keeps the class from being unloaded while it is checked, null if it already was
+      jobject klass = jni->NewLocalRef(bound->klass);
+      if (klass == nullptr) { return nullptr; }
+      bool isInstance = jni->IsInstanceOf(object, (jclass) klass);
+      jni->DeleteLocalRef(klass);
+      return isInstance ? bound->id : nullptr;
+    }
+
+    /**
+     * @return null unless bound to klass
+     */
+    Id findIn(jclass klass) const {
+      const Binding *bound = binding.load(std::memory_order_acquire);
+      return bound != nullptr && jni->IsSameObject(bound->klass, klass) ? bound->id : nullptr;
+    }
+
+    /**
+     * Keep the id unless the slot holds one of a class that is still loaded. Sites called with unrelated classes
+     * keep the first one and resolve the others on every call
+     */
+    void bind(jclass klass, Id id) {
+      const Binding *bound = binding.load(std::memory_order_acquire);
+      if (bound != nullptr && !jni->IsSameObject(bound->klass, nullptr)) { return; }
+
+      auto *replacement = new Binding{jni->NewWeakGlobalRef(klass), id};
+      // A replaced binding is never freed, other threads may still read it. That only happens once per unloaded class
+      if (!binding.compare_exchange_strong(bound, replacement, std::memory_order_acq_rel)) {
+        jni->DeleteWeakGlobalRef(replacement->klass);
+        delete replacement;
+      }
+    }
+  };
+
+  template<typename Name, typename Signature>
+  inline static MemberSlot<jfieldID> fieldSlot;
+
+  template<typename Name, typename Signature>
+  inline static MemberSlot<jfieldID> staticFieldSlot;
+
+  template<typename Name, typename Signature>
+  inline static MemberSlot<jmethodID> methodSlot;
+
+  template<typename Name, typename Signature>
+  inline static MemberSlot<jmethodID> staticMethodSlot;
+
+  template<typename Name, typename Signature>
+  static jfieldID getFieldId(jobject object) {
+    if (jfieldID fieldId = fieldSlot<Name, Signature>.findFor(object); fieldId != nullptr) { return fieldId; }
+
+    jclass klass = jni->GetObjectClass(object);
+    checkJniException(jni);
+    jfieldID fieldId = jni->GetFieldID(klass, Name::data(), Signature::data());
+    checkJniException(jni);
+    fieldSlot<Name, Signature>.bind(klass, fieldId);
+    jni->DeleteLocalRef(klass);
+    return fieldId;
+  }
+
+  template<typename Name, typename Signature>
+  static jfieldID getFieldIdIn(jclass klass) {
+    if (jfieldID fieldId = fieldSlot<Name, Signature>.findIn(klass); fieldId != nullptr) { return fieldId; }
+
+    jfieldID fieldId = jni->GetFieldID(klass, Name::data(), Signature::data());
+    checkJniException(jni);
+    fieldSlot<Name, Signature>.bind(klass, fieldId);
+    return fieldId;
+  }
+
+  template<typename Name, typename Signature>
+  static jfieldID getStaticFieldId(jclass klass) {
+    if (jfieldID fieldId = staticFieldSlot<Name, Signature>.findIn(klass); fieldId != nullptr) { return fieldId; }
+
+    jfieldID fieldId = jni->GetStaticFieldID(klass, Name::data(), Signature::data());
+    checkJniException(jni);
+    staticFieldSlot<Name, Signature>.bind(klass, fieldId);
+    return fieldId;
+  }
+
+  template<typename Name, typename Signature>
+  static jmethodID getMethodId(jobject object) {
+    if (jmethodID methodId = methodSlot<Name, Signature>.findFor(object); methodId != nullptr) { return methodId; }
+
+    jclass klass = jni->GetObjectClass(object);
+    checkJniException(jni);
+    jmethodID methodId = jni->GetMethodID(klass, Name::data(), Signature::data());
+    checkJniException(jni);
+    methodSlot<Name, Signature>.bind(klass, methodId);
+    jni->DeleteLocalRef(klass);
+    return methodId;
+  }
+
+  template<typename Name, typename Signature>
+  static jmethodID getMethodIdIn(jclass klass) {
+    if (jmethodID methodId = methodSlot<Name, Signature>.findIn(klass); methodId != nullptr) { return methodId; }
+
+    jmethodID methodId = jni->GetMethodID(klass, Name::data(), Signature::data());
+    checkJniException(jni);
+    methodSlot<Name, Signature>.bind(klass, methodId);
+    return methodId;
+  }
+
+  template<typename Name, typename Signature>
+  static jmethodID getStaticMethodId(jclass klass) {
+    if (jmethodID methodId = staticMethodSlot<Name, Signature>.findIn(klass); methodId != nullptr) { return methodId; }
+
+    jmethodID methodId = jni->GetStaticMethodID(klass, Name::data(), Signature::data());
+    checkJniException(jni);
+    staticMethodSlot<Name, Signature>.bind(klass, methodId);
+    return methodId;
+  }
+
   template<class PassedType>
   static auto toJniType(PassedType arg) {
     return arg;
   }
 
   static auto toJniType(std::string_view arg) {
-    //TODO: Figure out how to fix leak, can't use any destructors as those become non-trivial types
-    //TODO: Perhaps add it to some list for later cleanup?
+    // A destructor would make the argument a non-trivial type, the string is freed with the caller's LocalFrame
     return jni->NewStringUTF(arg.data());
   }
 
@@ -310,6 +443,31 @@ public:
     jni = tjni;
   }
 
+  /**
+   * Local references created while the frame is alive, by JNI or JVMTI, are freed when it goes out of scope.
+   * Running with -Xcheck:jni warns about frames that grow beyond their capacity.
+   */
+  class LocalFrame {
+  public:
+    /**
+     * @param capacity local references the frame must hold without growing
+     */
+    explicit LocalFrame(jint capacity) {
+      if (jni->PushLocalFrame(capacity) != JNI_OK) {
+        checkJniException(jni);
+        throw JniError("Failed to reserve " + std::to_string(capacity) + " local references");
+      }
+    }
+
+    ~LocalFrame() {
+      jni->PopLocalFrame(nullptr);
+    }
+
+    LocalFrame(const LocalFrame &) = delete;
+
+    LocalFrame &operator=(const LocalFrame &) = delete;
+  };
+
   static jclass getClass(std::string_view className) {
     jclass clazz = jni->FindClass(className.data());
     checkJniException(jni);
@@ -324,10 +482,9 @@ public:
   //TODO: arrays, e.g. invokeVirtual(obj, method, ([B)V, (std::vector<char>? char[]?))
   //TODO: new, invokespecial
 
-  template<char... Signature>
-  static auto getStatic(jclass klass, std::string_view fieldName, irqus::typestring<Signature...> signature) {
-    jfieldID fieldId = jni->GetFieldID(klass, fieldName.data(), signature.data());
-    checkJniException(jni);
+  template<char... Name, char... Signature>
+  static auto getStatic(jclass klass, irqus::typestring<Name...> fieldName, irqus::typestring<Signature...> signature) {
+    jfieldID fieldId = getStaticFieldId<decltype(fieldName), decltype(signature)>(klass);
 
     constexpr Type fieldType = typeOf(signature.data()).type;
     JniScopedExceptionChecker beforeReturn;
@@ -357,12 +514,12 @@ public:
     }
   }
 
-  template<char... Signature, typename ArgType>
-  static void putStatic(jclass klass, std::string_view fieldName, irqus::typestring<Signature...> signature, ArgType value) {
+  template<char... Name, char... Signature, typename ArgType>
+  static void putStatic(jclass klass, irqus::typestring<Name...> fieldName, irqus::typestring<Signature...> signature,
+                        ArgType value) {
     constexpr FieldSignatureChecker<ArgType> checker(signature.data());
 
-    jfieldID fieldId = jni->GetFieldID(klass, fieldName.data(), signature.data());
-    checkJniException(jni);
+    jfieldID fieldId = getStaticFieldId<decltype(fieldName), decltype(signature)>(klass);
 
     constexpr Type fieldType = checker.getFieldType().type;
     if constexpr (fieldType == Type::IntType) {
@@ -391,13 +548,9 @@ public:
     checkJniException(jni);
   }
 
-  template<char... Signature>
-  static auto getField(jobject object, std::string_view fieldName, irqus::typestring<Signature...> signature) {
-    jclass klass = jni->GetObjectClass(object);
-    checkJniException(jni);
-    jfieldID fieldId = jni->GetFieldID(klass, fieldName.data(), signature.data());
-    checkJniException(jni);
-    jni->DeleteLocalRef(klass);
+  template<char... Name, char... Signature>
+  static auto getField(jobject object, irqus::typestring<Name...> fieldName, irqus::typestring<Signature...> signature) {
+    jfieldID fieldId = getFieldId<decltype(fieldName), decltype(signature)>(object);
 
     constexpr Type fieldType = typeOf(signature.data()).type;
     JniScopedExceptionChecker beforeReturn;
@@ -427,15 +580,12 @@ public:
     }
   }
 
-  template<char... Signature, typename ArgType>
-  static void putField(jobject object, std::string_view fieldName, irqus::typestring<Signature...> signature, ArgType value) {
+  template<char... Name, char... Signature, typename ArgType>
+  static void putField(jobject object, irqus::typestring<Name...> fieldName, irqus::typestring<Signature...> signature,
+                       ArgType value) {
     constexpr FieldSignatureChecker<ArgType> checker(signature.data());
 
-    jclass klass = jni->GetObjectClass(object);
-    checkJniException(jni);
-    jfieldID fieldId = jni->GetFieldID(klass, fieldName.data(), signature.data());
-    checkJniException(jni);
-    jni->DeleteLocalRef(klass);
+    jfieldID fieldId = getFieldId<decltype(fieldName), decltype(signature)>(object);
 
     constexpr Type fieldType = checker.getFieldType().type;
     if constexpr (fieldType == Type::IntType) {
@@ -464,12 +614,12 @@ public:
     checkJniException(jni);
   }
 
-  template<char... Signature, typename... ArgType>
-  static auto invokeStatic(jclass klass, std::string_view methodName, irqus::typestring<Signature...> signature, ArgType... args) {
+  template<char... Name, char... Signature, typename... ArgType>
+  static auto invokeStatic(jclass klass, irqus::typestring<Name...> methodName, irqus::typestring<Signature...> signature,
+                           ArgType... args) {
     constexpr SignatureChecker<ArgType...> checker(signature.data());
 
-    jmethodID methodId = jni->GetStaticMethodID(klass, methodName.data(), signature.data());
-    checkJniException(jni);
+    jmethodID methodId = getStaticMethodId<decltype(methodName), decltype(signature)>(klass);
 
     constexpr TypeAndDim retType = checker.getRetType();
     JniScopedExceptionChecker beforeReturn;
@@ -504,15 +654,12 @@ public:
     }
   }
 
-  template<char... Signature, typename... ArgType>
-  static auto invokeVirtual(jobject object, std::string_view methodName, irqus::typestring<Signature...> signature, ArgType... args) {
+  template<char... Name, char... Signature, typename... ArgType>
+  static auto invokeVirtual(jobject object, irqus::typestring<Name...> methodName,
+                            irqus::typestring<Signature...> signature, ArgType... args) {
     constexpr SignatureChecker<ArgType...> checker(signature.data());
 
-    jclass klass = jni->GetObjectClass(object);
-    checkJniException(jni);
-    jmethodID methodId = jni->GetMethodID(klass, methodName.data(), signature.data());
-    checkJniException(jni);
-    jni->DeleteLocalRef(klass);
+    jmethodID methodId = getMethodId<decltype(methodName), decltype(signature)>(object);
 
     constexpr Type retType = checker.getRetType().type;
     JniScopedExceptionChecker beforeReturn;
@@ -547,13 +694,13 @@ public:
     }
   }
 
-  template<char... Signature, typename... ArgType>
-  static auto invokeSpecial(jobject object, jclass clazz, std::string_view methodName, irqus::typestring<Signature...> signature, ArgType... args) {
+  template<char... Name, char... Signature, typename... ArgType>
+  static auto invokeSpecial(jobject object, jclass clazz, irqus::typestring<Name...> methodName,
+                            irqus::typestring<Signature...> signature, ArgType... args) {
     // JVMS 6.5 invokespecial note: The invokespecial instruction was named invokenonvirtual prior to JDK release 1.0.2.
     constexpr SignatureChecker<ArgType...> checker(signature.data());
 
-    jmethodID methodId = jni->GetMethodID(clazz, methodName.data(), signature.data());
-    checkJniException(jni);
+    jmethodID methodId = getMethodIdIn<decltype(methodName), decltype(signature)>(clazz);
 
     constexpr Type retType = checker.getRetType().type;
     JniScopedExceptionChecker beforeReturn;
@@ -588,6 +735,24 @@ public:
     }
   }
 
+  /**
+   * Resolve the members every NPE may use up front, so the first NPE does not pay for it
+   */
+  static void bindWellKnownMembers() {
+    // Bound in the declaring classes, every object and throwable is an instance of them
+    jclass objectClass = getClass("java/lang/Object");
+    getMethodIdIn<decltype(jniname("toString")), decltype(jnisig("()Ljava/lang/String;"))>(objectClass);
+    jclass throwableClass = getClass("java/lang/Throwable");
+    getFieldIdIn<decltype(jniname("detailMessage")), decltype(jnisig("Ljava/lang/String;"))>(throwableClass);
+    jclass arraysClass = getClass("java/util/Arrays");
+    getStaticMethodId<decltype(jniname("deepToString")),
+                      decltype(jnisig("([Ljava/lang/Object;)Ljava/lang/String;"))>(arraysClass);
+
+    deleteLocalRef(objectClass);
+    deleteLocalRef(throwableClass);
+    deleteLocalRef(arraysClass);
+  }
+
   static jclass getClass(jobject obj) {
     jclass cls = jni->GetObjectClass(obj);
     checkJniException(jni);
@@ -599,12 +764,12 @@ public:
   static void test() {
     using std::string_view_literals::operator ""sv;
 
-    std::string a = invokeVirtual(nullptr, "", jnisig("(IIJLjava/lang/String;I)Ljava/lang/String;"), 1, 1, 3l, ""sv, 1);
+    std::string a = invokeVirtual(nullptr, jniname("a"), jnisig("(IIJLjava/lang/String;I)Ljava/lang/String;"), 1, 1, 3l, ""sv, 1);
 //    int i = Jni::invokeVirtual(nullptr, "", jnisig("()V"));
 //    int f = Jni::invokeVirtual(nullptr, "", jnisig("()I"), 13);
 //    std::string b = invokeVirtual(nullptr, "", jnisig("(Ljava/lang/ObjectIIJ)Ljava/lang/String"), nullptr, 1, 2, 3l);
     [[maybe_unused]]
-    bool c = invokeStatic(nullptr, "", jnisig("(IIJLjava/lang/String;I)Z"), 1, 1, 3l, ""sv, 1);
+    bool c = invokeStatic(nullptr, jniname("c"), jnisig("(IIJLjava/lang/String;I)Z"), 1, 1, 3l, ""sv, 1);
 //    std::string d = invokeStatic(nullptr, "", jnisig("([[[I)Ljava/lang/String;"), (int[1][1][1]){{{1}}});
   }
 
@@ -9,6 +9,7 @@
 #include "util.h"
 #include "bytecode/Method.h"
 #include "api/Jni.h"
+#include "api/JvmtiBuffer.h"
 
 //TODO:Specialized error messages for each method?
 //TODO: split regular wrapped calls from ones returning compound types and additional transformation?
@@ -28,9 +29,16 @@ class Jvmti {
     }
   }
 
-  static void JNICALL vmInit(jvmtiEnv *jvmti_env, JNIEnv *jni_env, jthread thread) {
-    logger->debug("VMInit\n");
-  }
+  static void JNICALL vmInit(jvmtiEnv *jvmti_env, JNIEnv *jni_env, jthread thread);
+
+  static void JNICALL threadStart(jvmtiEnv *jvmti_env, JNIEnv *jni_env, jthread thread);
+
+  static void JNICALL objectFree(jvmtiEnv *jvmti_env, jlong tag);
+
+  /**
+   * Enable exception events for the threads already running, later ones are enabled by threadStart
+   */
+  static void enableThreadExceptionEvents();
 
 public:
 
@@ -48,9 +56,22 @@ public:
 
   static jclass getMethodDeclaringClass(jmethodID method);
 
-  static std::vector<uint8_t> getBytecodes(jmethodID method);
+  /**
+   * Type signature of the class, e.g. Ljava/lang/String;
+   */
+  static std::string getClassSignature(jclass klass);
 
-  static ConstPool getConstPool(jclass klass);
+  /**
+   * @return null for the boot loader
+   */
+  static jobject getClassLoader(jclass klass);
+
+  static JvmtiBuffer getBytecodes(jmethodID method);
+
+  /**
+   * Pool read in place from the JVMTI buffer, which it keeps alive
+   */
+  static std::shared_ptr<const ConstPool> getConstPool(jclass klass);
 
   static uint32_t getMethodModifiers(jmethodID methodId);
 
@@ -104,11 +125,21 @@ public:
 
   static uint32_t getFrameCount(jthread thread);
 
-  //endregion
+  /**
+   * Enable or disable exception events for one thread, only has an effect with the threadEvents option.
+   * Events enabled globally are sent to every thread.
+   */
+  static void setExceptionEvents(jthread thread, bool enabled);
+
+  /**
+   * Fill frames with the top maxFrames frames of the thread in one stack walk
+   * @return number of frames filled
+   */
+  static uint32_t getStackTrace(jthread thread, jvmtiFrameInfo *frames, uint32_t maxFrames);
 
-  //region Converters to bytecode types
+  static jlong getTag(jobject object);
 
-  static Method toMethod(jmethodID methodId);
+  static void setTag(jobject object, jlong tag);
 
   //endregion
 
@@ -120,7 +151,7 @@ public:
     if (varType.dim != 0) {
       jobject array = getLocalObject(thread, depth, slot);
       jclass arraysClass = Jni::getClass("java/util/Arrays");
-      std::string result = Jni::invokeStatic(arraysClass, "deepToString", jnisig("([Ljava/lang/Object;)Ljava/lang/String;"), array);
+      std::string result = Jni::invokeStatic(arraysClass, jniname("deepToString"), jnisig("([Ljava/lang/Object;)Ljava/lang/String;"), array);
       Jni::deleteLocalRef(array);
       Jni::deleteLocalRef(arraysClass);
       return result;
@@ -136,7 +167,7 @@ public:
       return std::to_string(getLocalDouble(thread, depth, slot));
     } else if (varType.type == Type::ObjectType || varType.type == Type::StringType) {
       jobject obj = getLocalObject(thread, depth, slot);
-      return obj == nullptr ? "null" : Jni::invokeVirtual(obj, "toString", jnisig("()Ljava/lang/String;"));
+      return obj == nullptr ? "null" : Jni::invokeVirtual(obj, jniname("toString"), jnisig("()Ljava/lang/String;"));
     } else {
       throw JniError("Unknown variable type");
     }
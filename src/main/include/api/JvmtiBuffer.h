@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <jvmti.h>
+
+#include "bytecode/ByteView.h"
+
+/**
+ * Memory allocated by a JVMTI function such as GetBytecodes, deallocated when the buffer is destroyed.
+ * Parsing a view of it in place saves copying the bytes into a vector first.
+ */
+class JvmtiBuffer {
+  jvmtiEnv *env = nullptr;
+  uint8_t *bytes = nullptr;
+  size_t length = 0;
+
+public:
+  JvmtiBuffer() = default;
+
+  /**
+   * @param env environment that allocated bytes, it may be deallocated on another thread
+   */
+  JvmtiBuffer(jvmtiEnv *env, uint8_t *bytes, size_t length) : env(env), bytes(bytes), length(length) {}
+
+  JvmtiBuffer(JvmtiBuffer &&other) noexcept :
+      env(other.env), bytes(std::exchange(other.bytes, nullptr)), length(std::exchange(other.length, 0)) {}
+
+  JvmtiBuffer &operator=(JvmtiBuffer &&other) noexcept {
+    std::swap(env, other.env);
+    std::swap(bytes, other.bytes);
+    std::swap(length, other.length);
+    return *this;
+  }
+
+  JvmtiBuffer(const JvmtiBuffer &) = delete;
+
+  JvmtiBuffer &operator=(const JvmtiBuffer &) = delete;
+
+  ~JvmtiBuffer() {
+    if (bytes != nullptr) { env->Deallocate(bytes); }
+  }
+
+  operator ByteView() const { return ByteView(bytes, length); }
+
+  const uint8_t *data() const { return bytes; }
+
+  size_t size() const { return length; }
+};
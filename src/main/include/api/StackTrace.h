@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstdint>
+#include <utility>
+#include <jvmti.h>
+
+/**
+ * Frames of a thread captured by a single GetStackTrace on first use, instead of a stack walk for every
+ * GetFrameCount and GetFrameLocation. Frames are written to a buffer reused by the thread, a trace taken while another
+ * is alive, e.g. for an NPE thrown by Java code run to print a parameter, gets its own buffer.
+ * Only the top MAX_FRAMES frames are captured.
+ */
+class StackTrace {
+public:
+  static constexpr uint32_t MAX_FRAMES = 1024;
+
+  /**
+   * @param thread null for the current thread
+   */
+  explicit StackTrace(jthread thread);
+
+  ~StackTrace();
+
+  StackTrace(const StackTrace &) = delete;
+
+  StackTrace &operator=(const StackTrace &) = delete;
+
+  /**
+   * Number of captured frames
+   */
+  uint32_t size();
+
+  /**
+   * Method and location executed at depth, must be less than size()
+   */
+  std::pair<jmethodID, jlocation> getFrame(uint32_t depth);
+
+private:
+  jthread thread;
+  jvmtiFrameInfo *frames;
+  uint32_t frameCount = 0;
+  bool captured = false;
+
+  void capture();
+};
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+/**
+ * Read-only view of bytes owned elsewhere, e.g. a vector, a mapped file or the class data passed to
+ * ClassFileLoadHook. The bytes must outlive the view.
+ */
+class ByteView {
+  const uint8_t *bytes = nullptr;
+  size_t length = 0;
+
+public:
+  constexpr ByteView() = default;
+
+  constexpr ByteView(const uint8_t *bytes, size_t length) : bytes(bytes), length(length) {}
+
+  ByteView(const std::vector<uint8_t> &vector) : bytes(vector.data()), length(vector.size()) {}
+
+  const uint8_t *data() const { return bytes; }
+
+  size_t size() const { return length; }
+
+  bool empty() const { return length == 0; }
+
+  const uint8_t *begin() const { return bytes; }
+
+  const uint8_t *end() const { return bytes + length; }
+
+  uint8_t operator[](size_t pos) const { return bytes[pos]; }
+
+  uint8_t at(size_t pos) const {
+    if (pos >= length) { throw std::out_of_range("Byte offset out of range"); }
+    return bytes[pos];
+  }
+
+  ByteView subview(size_t offset, size_t count) const {
+    if (offset > length || count > length - offset) { throw std::out_of_range("Byte range out of range"); }
+    return ByteView(bytes + offset, count);
+  }
+};
+
+/**
+ * Bytes that are either owned or borrowed from memory that outlives the buffer.
+ * Copies of owned bytes are deep, copies of borrowed bytes borrow the same memory.
+ */
+class ByteBuffer {
+  std::vector<uint8_t> owned;
+  ByteView view;
+
+public:
+  ByteBuffer() = default;
+
+  explicit ByteBuffer(std::vector<uint8_t> bytes) : owned(std::move(bytes)), view(owned) {}
+
+  explicit ByteBuffer(ByteView borrowed) : view(borrowed) {}
+
+  ByteBuffer(const ByteBuffer &other) : owned(other.owned), view(other.isOwned() ? ByteView(owned) : other.view) {}
+
+  // Moving a vector keeps its storage, the view stays valid
+  ByteBuffer(ByteBuffer &&other) noexcept = default;
+
+  ByteBuffer &operator=(ByteBuffer other) noexcept {
+    owned = std::move(other.owned);
+    view = other.view;
+    return *this;
+  }
+
+  bool isOwned() const { return !owned.empty(); }
+
+  operator ByteView() const { return view; }
+
+  const uint8_t *data() const { return view.data(); }
+
+  size_t size() const { return view.size(); }
+
+  const uint8_t *begin() const { return view.begin(); }
+
+  const uint8_t *end() const { return view.end(); }
+
+  uint8_t operator[](size_t pos) const { return view[pos]; }
+
+  uint8_t at(size_t pos) const { return view.at(pos); }
+};
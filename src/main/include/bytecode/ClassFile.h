@@ -0,0 +1,115 @@
+#pragma once
+
+#include <string_view>
+#include <vector>
+#include <cstdint>
+
+#include "ByteView.h"
+#include "ConstPool.h"
+#include "LocalVariableTable.h"
+
+struct AttributeInfo {
+  uint16_t nameIndex;
+  size_t offset;   // Offset of attribute_name_index in class file
+  uint32_t length; // Length of attribute info, excluding the 6 byte header
+};
+
+struct MemberInfo {
+  uint16_t accessFlags;
+  uint16_t nameIndex;
+  uint16_t descriptorIndex;
+  std::vector<AttributeInfo> attributes;
+};
+
+/**
+ * Location of the bytecode and nested attributes of a Code attribute, JVMS §4.7.3
+ */
+struct CodeInfo {
+  size_t codeOffset; // Offset of the first instruction in class file
+  uint32_t codeLength;
+  // handler_pc of each exception table entry
+  std::vector<uint16_t> handlerPcs;
+  std::vector<AttributeInfo> attributes;
+};
+
+/**
+ * Class file structure as described in JVMS §4.1
+ * Only offsets of members and attributes are recorded, contents are read from the bytes on demand.
+ * The bytes are either owned or borrowed, e.g. from a MappedFile, in which case nothing is copied
+ * and the constant pool, code and names returned live as long as the borrowed bytes.
+ */
+class ClassFile {
+  ByteBuffer bytes;
+  ConstPool constPool;
+  size_t constPoolEnd = 0;
+  uint16_t accessFlags = 0;
+  uint16_t thisClass = 0;
+  uint16_t superClass = 0;
+  std::vector<MemberInfo> fields;
+  std::vector<MemberInfo> methods;
+  std::vector<AttributeInfo> attributes;
+
+  void parse();
+
+  /**
+   * Throws InvalidArgument unless count bytes at offset are in the class file, checked before every read since the
+   * bytes may come from a truncated file or a broken transformer
+   */
+  void requireBytes(size_t offset, size_t count, const char *what) const;
+
+  std::vector<MemberInfo> readMembers(size_t &offset) const;
+
+  std::vector<AttributeInfo> readAttributes(size_t &offset) const;
+
+public:
+  static const uint32_t MAGIC = 0xCAFEBABE;
+
+  explicit ClassFile(std::vector<uint8_t> bytes);
+
+  /**
+   * Parse the class file in place, the bytes must outlive the class file and everything read from it
+   */
+  explicit ClassFile(ByteView bytes);
+
+  // The constant pool points into bytes, a copy would point into the original
+  ClassFile(const ClassFile &) = delete;
+
+  ClassFile &operator=(const ClassFile &) = delete;
+
+  ClassFile(ClassFile &&) = default;
+
+  ByteView getBytes() const { return bytes; }
+
+  const ConstPool &getConstPool() const { return constPool; }
+
+  /**
+   * Offset of the first byte after constant pool entries, i.e. access_flags
+   */
+  size_t getConstPoolEnd() const { return constPoolEnd; }
+
+  uint16_t getConstPoolCount() const;
+
+  uint16_t getMajorVersion() const;
+
+  /**
+   * Constant pool index of the Class entry of this class
+   */
+  uint16_t getThisClass() const { return thisClass; }
+
+  const std::vector<MemberInfo> &getFields() const { return fields; }
+
+  const std::vector<MemberInfo> &getMethods() const { return methods; }
+
+  const std::vector<AttributeInfo> &getAttributes() const { return attributes; }
+
+  const MemberInfo *findMethod(std::string_view name, std::string_view descriptor) const;
+
+  const AttributeInfo *findAttribute(const std::vector<AttributeInfo> &attributes, std::string_view name) const;
+
+  CodeInfo readCode(const AttributeInfo &codeAttribute) const;
+
+  /**
+   * Variables of a LocalVariableTable attribute, JVMS §4.7.13
+   */
+  LocalVariableTable readLocalVariableTable(const AttributeInfo &localVariableTable) const;
+};
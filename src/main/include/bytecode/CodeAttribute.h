@@ -5,25 +5,54 @@
 #include <vector>
 #include <cstdint>
 
+#include "ByteView.h"
 #include "ConstPool.h"
 #include "LocalVariableTable.h"
 #include "Constants.h"
+#include "OpcodeInfo.h"
 
+/**
+ * Bytecode of a method. Instruction boundaries are decoded lazily, only as far as the requested offset,
+ * so the decoding state is mutable and an instance must not be shared between threads.
+ */
 class CodeAttribute {
 private:
-  std::vector<uint8_t> code;
-  std::vector<size_t> instructions; // Offset to code array indicating instruction
+  // The JVM limits code to 65535 bytes, every offset fits 16 bits
+  static constexpr size_t MAX_CODE_LENGTH = 65535;
+
+  ByteBuffer code;
   //std::set<Attribute> - LineNumberTable? LocalVariableTable LocalVariableTypeTable
 
   LocalVariableTable localVariables;
 
+  // Offsets of the decoded instructions
+  mutable std::vector<uint16_t> instructions;
+  // One bit per code byte, set where an instruction starts
+  mutable std::vector<uint64_t> instructionStarts;
+  // Number of instructions before each 64 byte word of instructionStarts
+  mutable std::vector<uint16_t> instructionRanks;
+  // Offset of the first instruction that is not decoded yet
+  mutable size_t decodedEnd = 0;
+
   void init();
 
+  /**
+   * Decode instructions until the one containing offset, or the end of the code
+   */
+  void decodeUntil(size_t offset) const;
+
 public:
   CodeAttribute(std::vector<uint8_t> code, LocalVariableTable localVariables);
 
   explicit CodeAttribute(std::vector<uint8_t> code);
 
+  /**
+   * Code borrowed from e.g. a class file read in place, the bytes must outlive the attribute
+   */
+  CodeAttribute(ByteView code, LocalVariableTable localVariables);
+
+  explicit CodeAttribute(ByteView code);
+
   std::string toString(const ConstPool &constPool) const;
 
   std::string printInstruction(const ConstPool &constPool, size_t offset) const;
@@ -38,11 +67,25 @@ public:
     return code[offset];
   }
 
-  uint8_t getInstructionLength(size_t offset) const;
+  size_t getInstructionLength(size_t offset) const;
+
+  ByteView getCode() const { return code; }
+
+  /**
+   * Offsets of all instructions in order, decodes the whole code
+   */
+  const std::vector<uint16_t> &getInstructions() const;
 
-  const std::vector<uint8_t> &getCode() const { return code; }
+  /**
+   * Whether an instruction starts at offset, decodes up to offset
+   */
+  bool isInstructionStart(size_t offset) const;
 
-  const std::vector<size_t> &getInstructions() const { return instructions; }
+  /**
+   * Position of the instruction at offset in getInstructions(), decodes up to offset.
+   * Throws InvalidArgument if no instruction starts at offset
+   */
+  size_t getInstructionIndex(size_t offset) const;
 
   //TODO: Methods for accessing specific refs, e.g. method signature
 };
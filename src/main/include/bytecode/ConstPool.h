@@ -1,408 +1,125 @@
 #pragma once
 
-#include <utility>
-#include <vector>
-#include <functional>
+#include <cstdint>
 #include <iostream>
-#include <memory>
-
-class ConstPool;
-
-class ConstInfo {
-private:
-  size_t index;
-
-public:
-  static std::unique_ptr<ConstInfo> read(const std::vector<uint8_t> &constPoolBytes, size_t &offset, size_t index);
-
-  explicit ConstInfo(size_t _index) : index(_index) {}
-
-  virtual ~ConstInfo() = default;
-
-  virtual ConstInfo *clone() const = 0;
-
-  virtual void visit(const ConstPool &constPool, std::function<void(const std::string &)> visitor, bool firstLevel = true) const = 0;
-
-  virtual uint8_t getTag() const = 0;
-};
-
-class ConstInfoPadding : public ConstInfo {
-public:
-  static const uint8_t tag = 0;
-
-  using ConstInfo::ConstInfo;
-
-  ConstInfoPadding *clone() const override { return new ConstInfoPadding(*this); }
-
-  void visit(const ConstPool &constPool, std::function<void(const std::string &)> visitor, bool firstLevel = true) const override;
-
-  uint8_t getTag() const override { return tag; }
-};
-
-//std::ostream &operator<<(std::ostream &out, const ConstInfoPadding &constInfoPadding) {
-//  return out << "padding\n";
-//}
-
-class UTF8Info : public ConstInfo {
-private:
-  std::string string;
-
-public:
-  static const uint8_t tag = 1;
-
-  static std::unique_ptr<ConstInfo> read(const std::vector<uint8_t> &constPoolBytes, size_t &offset, size_t index);
-
-  UTF8Info(std::string string, size_t index) : ConstInfo(index), string(std::move(string)) {}
-
-  UTF8Info *clone() const override { return new UTF8Info(*this); }
-
-  void visit(const ConstPool &constPool, std::function<void(const std::string &)> visitor, bool firstLevel = true) const override;
-
-  uint8_t getTag() const override { return tag; }
-
-  const std::string &getString() const { return string; }
-};
-
-//std::ostream &operator<<(std::ostream &out, const UTF8Info &utf8Info) {
-//  return out << "UTF8 \"" << utf8Info.getString() << "\"\n";
-//}
-
-class IntegerInfo : public ConstInfo {
-private:
-  int32_t value;
-
-public:
-  static const uint8_t tag = 3;
-
-  static std::unique_ptr<ConstInfo> read(const std::vector<uint8_t> &constPoolBytes, size_t &offset, size_t index);
-
-  IntegerInfo(int32_t value, size_t index) : ConstInfo(index), value(value) {}
-
-  IntegerInfo *clone() const override { return new IntegerInfo(*this); }
-
-  void visit(const ConstPool &constPool, std::function<void(const std::string &)> visitor, bool firstLevel = true) const override;
-
-  uint8_t getTag() const override { return tag; }
-
-  int32_t getValue() const { return value; }
-};
-
-//std::ostream &operator<<(std::ostream &out, const IntegerInfo &integerInfo) {
-//  return out << "Integer " << integerInfo.getValue() << "\n";
-//}
-
-class FloatInfo : public ConstInfo {
-private:
-  float value;
-public:
-  static const uint8_t tag = 4;
-
-  static std::unique_ptr<ConstInfo> read(const std::vector<uint8_t> &constPoolBytes, size_t &offset, size_t index);
-
-  FloatInfo(float value, size_t index) : ConstInfo(index), value(value) {}
-
-  FloatInfo *clone() const override { return new FloatInfo(*this); }
-
-  void visit(const ConstPool &constPool, std::function<void(const std::string &)> visitor, bool firstLevel = true) const override;
-
-  uint8_t getTag() const override { return tag; }
-
-  float getValue() const { return value; }
-};
-
-//std::ostream &operator<<(std::ostream &out, const FloatInfo &floatInfo) {
-//  return out << "Float " << floatInfo.getValue() << "\n";
-//}
-
-class LongInfo : public ConstInfo {
-private:
-  int64_t value;
-public:
-  static const uint8_t tag = 5;
-
-  static std::unique_ptr<ConstInfo> read(const std::vector<uint8_t> &constPoolBytes, size_t &offset, size_t index);
-
-  LongInfo(int64_t value, size_t index) : ConstInfo(index), value(value) {}
-
-  LongInfo *clone() const override { return new LongInfo(*this); }
-
-  void visit(const ConstPool &constPool, std::function<void(const std::string &)> visitor, bool firstLevel = true) const override;
-
-  uint8_t getTag() const override { return tag; }
-
-  int64_t getValue() const { return value; }
-};
-
-//std::ostream &operator<<(std::ostream &out, const LongInfo &longInfo) {
-//  return out << "Long " << longInfo.getValue() << "\n";
-//}
-
-class DoubleInfo : public ConstInfo {
-private:
-  double value;
-public:
-  static const uint8_t tag = 6;
-
-  static std::unique_ptr<ConstInfo> read(const std::vector<uint8_t> &constPoolBytes, size_t &offset, size_t index);
-
-  DoubleInfo(double value, size_t index) : ConstInfo(index), value(value) {}
-
-  DoubleInfo *clone() const override { return new DoubleInfo(*this); }
-
-  void visit(const ConstPool &constPool, std::function<void(const std::string &)> visitor, bool firstLevel = true) const override;
-
-  uint8_t getTag() const override { return tag; }
-
-  double getValue() const { return value; }
-};
-
-//std::ostream &operator<<(std::ostream &out, const DoubleInfo &doubleInfo) {
-//  return out << "Double " << doubleInfo.getValue() << "\n";
-//}
-
-class ClassInfo : public ConstInfo {
-private:
-  uint16_t nameIndex;
-public:
-  static const uint8_t tag = 7;
-
-  static std::unique_ptr<ConstInfo> read(const std::vector<uint8_t> &constPoolBytes, size_t &offset, size_t index);
-
-  ClassInfo(uint16_t nameIndex, size_t index) : ConstInfo(index), nameIndex(nameIndex) {}
-
-  ClassInfo *clone() const override { return new ClassInfo(*this); }
-
-  void visit(const ConstPool &constPool, std::function<void(const std::string &)> visitor, bool firstLevel = true) const override;
-
-  uint8_t getTag() const override { return tag; }
-
-  uint16_t getNameIndex() const { return nameIndex; }
-};
-
-//std::ostream &operator<<(std::ostream &out, const ClassInfo &classInfo) {
-//  return out << "Class #" << classInfo.getNameIndex() << "\n";
-//}
-
-class StringInfo : public ConstInfo {
-private:
-  uint16_t stringIndex;
-public:
-  static const uint8_t tag = 8;
-
-  static std::unique_ptr<ConstInfo> read(const std::vector<uint8_t> &constPoolBytes, size_t &offset, size_t index);
-
-  StringInfo(uint16_t stringIndex, size_t index) : ConstInfo(index), stringIndex(stringIndex) {}
-
-  StringInfo *clone() const override { return new StringInfo(*this); }
-
-  void visit(const ConstPool &constPool, std::function<void(const std::string &)> visitor, bool firstLevel = true) const override;
-
-  uint8_t getTag() const override { return tag; }
-
-  uint16_t getStringIndex() const { return stringIndex; }
-};
-
-//std::ostream &operator<<(std::ostream &out, const StringInfo &stringInfo) {
-//  return out << "String #" << stringInfo.getStringIndex() << "\n";
-//}
-
-class MemberRefInfo : public ConstInfo {
-private:
-  uint16_t classIndex;
-  uint16_t nameAndTypeIndex;
-
-public:
-  MemberRefInfo(uint16_t classIndex, uint16_t nameAndTypeIndex, size_t index) : ConstInfo(index), classIndex(classIndex), nameAndTypeIndex(nameAndTypeIndex) {}
-
-  void visit(const ConstPool &constPool, std::function<void(const std::string &)> visitor, bool firstLevel = true) const override;
-
-  virtual std::string getTagName() const = 0;
-
-  uint16_t getClassIndex() const { return classIndex; }
-
-  uint16_t getNameAndTypeIndex() const { return nameAndTypeIndex; }
-};
-
-//std::ostream &operator<<(std::ostream &out, const MemberRefInfo &memberRefInfo) {
-//  return out << memberRefInfo.getTagName() << " #" << memberRefInfo.getClassIndex() << ".#" << memberRefInfo.getNameAndTypeIndex() << "\n";
-//}
-
-class FieldRefInfo : public MemberRefInfo {
-public:
-  static const uint8_t tag = 9;
-
-  static std::unique_ptr<ConstInfo> read(const std::vector<uint8_t> &constPoolBytes, size_t &offset, size_t index);
-
-  using MemberRefInfo::MemberRefInfo;
-
-  FieldRefInfo *clone() const override { return new FieldRefInfo(*this); }
-
-  uint8_t getTag() const override { return tag; }
-
-  std::string getTagName() const override { return "Field"; }
-};
-
-class MethodRefInfo : public MemberRefInfo {
-public:
-  static const uint8_t tag = 10;
-
-  static std::unique_ptr<ConstInfo> read(const std::vector<uint8_t> &constPoolBytes, size_t &offset, size_t index);
-
-  using MemberRefInfo::MemberRefInfo;
-
-  MethodRefInfo *clone() const override { return new MethodRefInfo(*this); }
-
-  uint8_t getTag() const override { return tag; }
-
-  std::string getTagName() const override { return "Method"; }
-};
-
-class InterfaceMethodRefInfo : public MemberRefInfo {
-public:
-  static const uint8_t tag = 11;
-
-  static std::unique_ptr<ConstInfo> read(const std::vector<uint8_t> &constPoolBytes, size_t &offset, size_t index);
-
-  using MemberRefInfo::MemberRefInfo;
-
-  InterfaceMethodRefInfo *clone() const override { return new InterfaceMethodRefInfo(*this); }
+#include <string>
+#include <string_view>
+#include <vector>
 
-  uint8_t getTag() const override { return tag; }
+#include "ByteView.h"
 
-  std::string getTagName() const override { return "InterfaceMethod"; }
+struct NameAndTypeRef {
+  std::string_view name;
+  std::string_view descriptor;
 };
 
-class NameAndTypeInfo : public ConstInfo {
-private:
-  uint16_t nameIndex;
-  uint16_t descriptorIndex;
-public:
-  static const uint8_t tag = 12;
-
-  static std::unique_ptr<ConstInfo> read(const std::vector<uint8_t> &constPoolBytes, size_t &offset, size_t index);
-
-  NameAndTypeInfo(uint16_t nameIndex, uint16_t descriptorIndex, size_t index) : ConstInfo(index), nameIndex(nameIndex), descriptorIndex(descriptorIndex) {}
-
-  NameAndTypeInfo *clone() const override { return new NameAndTypeInfo(*this); }
-
-  void visit(const ConstPool &constPool, std::function<void(const std::string &)> visitor, bool firstLevel = true) const override;
-
-  uint8_t getTag() const override { return tag; }
-
-  uint16_t getNameIndex() const { return nameIndex; }
-
-  uint16_t getDescriptorIndex() const { return descriptorIndex; }
+/**
+ * Resolved Fieldref, Methodref or InterfaceMethodref, class name is in internal form e.g. java/lang/String
+ */
+struct MemberRef {
+  std::string_view className;
+  std::string_view name;
+  std::string_view descriptor;
 };
 
-//std::ostream &operator<<(std::ostream &out, const NameAndTypeInfo &nameAndTypeInfo) {
-//  return out << "NameAndType #" << nameAndTypeInfo.getNameIndex() << ":#" << nameAndTypeInfo.getDescriptorIndex() << "\n";
-//}
-
-class MethodHandleInfo : public ConstInfo {
+/**
+ * Constant pool backed by its raw bytes. Only the offset of each entry is computed upfront,
+ * entries are decoded when requested. Returned string views point into the pool and live as long as it,
+ * or as long as the borrowed bytes for a pool read from a class file in place.
+ */
+class ConstPool {
 private:
-  uint8_t referenceKind;
-  uint16_t referenceIndex;
-public:
-  static const uint8_t tag = 15;
-
-  static std::unique_ptr<ConstInfo> read(const std::vector<uint8_t> &constPoolBytes, size_t &offset, size_t index);
-
-  MethodHandleInfo(uint8_t _referenceKind, uint16_t _referenceIndex, uint16_t _index) : ConstInfo(_index), referenceKind(_referenceKind), referenceIndex(_referenceIndex) {}
-
-  MethodHandleInfo *clone() const override { return new MethodHandleInfo(*this); }
+  ByteBuffer bytes;
+  // Offset of the tag of each entry in bytes, NO_ENTRY for index 0 and the slot following a Long or Double
+  std::vector<uint32_t> offsets;
 
-  void visit(const ConstPool &constPool, std::function<void(const std::string &)> visitor, bool firstLevel = true) const override;
+  /**
+   * Record entry offsets until count slots are indexed or the bytes end
+   * @return offset after the last entry
+   */
+  size_t index(size_t count);
 
-  uint8_t getTag() const override { return tag; }
+  /**
+   * Offset of the first byte after the tag, throws if the entry at index does not have the expected tag
+   */
+  size_t entryOffset(size_t index, uint8_t expectedTag) const;
 
-  uint8_t getReferenceKind() const { return referenceKind; }
+  void appendEntry(std::string &out, size_t index, bool identifier) const;
 
-  uint16_t getReferenceIndex() const { return referenceIndex; }
-};
-
-//std::ostream &operator<<(std::ostream &out, const MethodHandleInfo &methodHandleInfo) {
-//  return out << "MethodHandle " << methodHandleInfo.getReferenceKind() << " #" << methodHandleInfo.getReferenceIndex() << "\n";
-//}
-
-class MethodTypeInfo : public ConstInfo {
-private:
-  uint16_t descriptorIndex;
 public:
-  static const uint8_t tag = 16;
-
-  static std::unique_ptr<ConstInfo> read(const std::vector<uint8_t> &constPoolBytes, size_t &offset, size_t index);
+  static constexpr uint32_t NO_ENTRY = UINT32_MAX;
 
-  MethodTypeInfo(uint16_t _descriptorIndex, uint16_t _index) : ConstInfo(_index), descriptorIndex(_descriptorIndex) {}
-
-  MethodTypeInfo *clone() const override { return new MethodTypeInfo(*this); }
-
-  void visit(const ConstPool &constPool, std::function<void(const std::string &)> visitor, bool firstLevel = true) const override;
-
-  uint8_t getTag() const override { return tag; }
-
-  uint16_t getDescriptorIndex() const { return descriptorIndex; }
-};
+  /**
+   * Length of the entry starting at offset, including the tag byte
+   */
+  static size_t entryLength(ByteView constPoolBytes, size_t offset);
 
-//std::ostream &operator<<(std::ostream &out, const MethodTypeInfo &methodTypeInfo) {
-//  return out << "MethodType #" << methodTypeInfo.getDescriptorIndex() << "\n";
-//}
+  /**
+   * Read the constant pool of a class file in place, without copying the entries
+   * @param offset of the first entry, after constant_pool_count
+   * @param count constant_pool_count
+   */
+  static ConstPool read(ByteView classBytes, size_t offset, uint16_t count);
 
-class InvokeDynamicInfo : public ConstInfo {
-private:
-  uint16_t bootstrapMethodAttrIndex;
-  uint16_t nameAndTypeIndex;
-public:
-  static const uint8_t tag = 18;
+  ConstPool() : offsets{NO_ENTRY} {}
 
-  static std::unique_ptr<ConstInfo> read(const std::vector<uint8_t> &constPoolBytes, size_t &offset, size_t index);
+  /**
+   * Pool owning a copy of the entries, e.g. as returned by GetConstantPool
+   */
+  explicit ConstPool(std::vector<uint8_t> constPoolBytes);
 
-  InvokeDynamicInfo(uint16_t _bootstrapMethodAttrIndex, uint16_t _nameAndTypeIndex, uint16_t _index) :
-      ConstInfo(_index), bootstrapMethodAttrIndex(_bootstrapMethodAttrIndex), nameAndTypeIndex(_nameAndTypeIndex) {}
+  /**
+   * Pool borrowing the entries, the bytes must outlive the pool
+   */
+  explicit ConstPool(ByteView constPoolBytes);
 
-  InvokeDynamicInfo *clone() const override { return new InvokeDynamicInfo(*this); }
+  /**
+   * Tag of the entry at index, 0 for unusable slots. Throws std::out_of_range for an invalid index
+   */
+  uint8_t getTag(size_t index) const;
 
-  void visit(const ConstPool &constPool, std::function<void(const std::string &)> visitor, bool firstLevel = true) const override;
+  std::string_view getUtf8(size_t index) const;
 
-  uint8_t getTag() const override { return tag; }
+  int32_t getInteger(size_t index) const;
 
-  uint16_t getBootstrapMethodAttrIndex() const { return bootstrapMethodAttrIndex; }
+  float getFloat(size_t index) const;
 
-  uint16_t getNameAndTypeIndex() const { return nameAndTypeIndex; }
-};
+  int64_t getLong(size_t index) const;
 
-//std::ostream &operator<<(std::ostream &out, const InvokeDynamicInfo &invokeDynamicInfo) {
-//  return out << "InvokeDynamic #" << invokeDynamicInfo.getBootstrapMethodAttrIndex() << ":#" << invokeDynamicInfo.getNameAndTypeIndex() << "\n";
-//}
+  double getDouble(size_t index) const;
 
-class ConstPool {
-private:
-  size_t indexPos = 1;
-  std::vector<std::unique_ptr<ConstInfo>> entries;
+  /**
+   * Name of a Class entry in internal form, e.g. java/lang/Object or [I
+   */
+  std::string_view getClassName(size_t index) const;
 
-  void read(const std::vector<uint8_t> &constPoolBytes);
+  std::string_view getString(size_t index) const;
 
-  void read(std::ifstream, size_t count);
+  NameAndTypeRef getNameAndType(size_t index) const;
 
-public:
+  /**
+   * Resolve a Fieldref, Methodref or InterfaceMethodref
+   */
+  MemberRef getMemberRef(size_t index) const;
 
-  ConstPool() {
-    entries.push_back(std::make_unique<ConstInfoPadding>(0));
-  }
+  /**
+   * Name and method descriptor of an InvokeDynamic call site
+   */
+  NameAndTypeRef getInvokeDynamic(size_t index) const;
 
-  ConstPool(const std::vector<uint8_t> &constPoolBytes) {
-    entries.push_back(std::make_unique<ConstInfoPadding>(0));
-    read(constPoolBytes);
+  size_t size() const {
+    return offsets.size();
   }
 
-  const ConstInfo &get(size_t index) const {
-    return *entries.at(index);
+  size_t byteSize() const {
+    return bytes.size();
   }
 
-  size_t size() const {
-    return entries.size();
+  ByteView getBytes() const {
+    return bytes;
   }
 
   std::string entryToString(size_t index, bool identifier = true) const;
 
   void print() const;
-};
\ No newline at end of file
+};
@@ -1,33 +1,33 @@
 #pragma once
 
-#include "ConstPool.h"
+#include <cstdint>
 
 class Constants {
 public:
   static const char *CpInfoMnemonic[];
   static const char *ReferenceKindMnemonic[];
-  static const char *OpcodeMnemonic[];
-  static const uint8_t InstructionLength[];
   static const char *ArrayType[];
-  static const int OpCodeStackDelta[];
 };
 
 namespace CpInfo {
   enum CpInfo {
-    Utf8 = UTF8Info::tag,
-    Integer = IntegerInfo::tag,
-    Float = FloatInfo::tag,
-    Long = LongInfo::tag,
-    Double = DoubleInfo::tag,
-    Class = ClassInfo::tag,
-    String = StringInfo::tag,
-    Fieldref = FieldRefInfo::tag,
-    Methodref = MethodRefInfo::tag,
-    InterfaceMethodref = InterfaceMethodRefInfo::tag,
-    NameAndType = NameAndTypeInfo::tag,
-    MethodHandle = MethodHandleInfo::tag,
-    MethodType = MethodTypeInfo::tag,
-    InvokeDynamic = InvokeDynamicInfo::tag
+    Utf8 = 1,
+    Integer = 3,
+    Float = 4,
+    Long = 5,
+    Double = 6,
+    Class = 7,
+    String = 8,
+    Fieldref = 9,
+    Methodref = 10,
+    InterfaceMethodref = 11,
+    NameAndType = 12,
+    MethodHandle = 15,
+    MethodType = 16,
+    Dynamic = 17,
+    InvokeDynamic = 18,
+    Module = 19,
+    Package = 20
   };
 };
 
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "CodeAttribute.h"
+
+struct BasicBlock {
+  size_t start;                   // Offset of the first instruction
+  size_t end;                     // Offset following the last instruction
+  std::vector<size_t> successors; // Indexes of blocks control can pass to, exception handlers are not included
+};
+
+/**
+ * Basic blocks of a method and the control flow between them.
+ * Exception tables are not part of the bytecode, blocks reachable only through a handler have no predecessors.
+ * Handlers of a known exception table start a block.
+ */
+class ControlFlowGraph {
+  std::vector<BasicBlock> blocks;
+
+public:
+  /**
+   * @param handlerPcs handler offsets of the exception table, null if the table is not known
+   */
+  explicit ControlFlowGraph(const CodeAttribute &code, const std::vector<uint16_t> *handlerPcs = nullptr);
+
+  const std::vector<BasicBlock> &getBlocks() const { return blocks; }
+
+  /**
+   * Index of the block containing the instruction at offset
+   */
+  size_t getBlockIndex(size_t offset) const;
+
+  /**
+   * Offsets the instruction at offset can jump to, the following instruction is only included if it is a jump target
+   */
+  static std::vector<size_t> getJumpTargets(const CodeAttribute &code, size_t offset);
+
+  /**
+   * Whether execution can continue with the following instruction
+   */
+  static bool fallsThrough(uint8_t opCode);
+};
@@ -4,29 +4,40 @@
 
 #include "CodeAttribute.h"
 #include "ConstPool.h"
+#include "Symbols.h"
 
+/**
+ * Names and type are interned in Symbols, copying a Field is cheap
+ */
 class Field {
-  std::string className;
-  std::string fieldName;
-  std::string typeName;
+  const std::string *className;
+  const std::string *fieldName;
+  const TypeDescriptor *type;
 
 public:
-  Field(std::string_view className, std::string_view fieldName, std::string_view typeName) :
-      className(className), fieldName(fieldName), typeName(typeName) {}
+  Field(const std::string &className, const std::string &fieldName, const TypeDescriptor &type) :
+      className(&className), fieldName(&fieldName), type(&type) {}
 
   static Field readFromFieldInsn(const CodeAttribute &code, const ConstPool &constPool, size_t bci);
 
   static Field readFromMemberRef(const ConstPool &constPool, size_t refId);
 
   const std::string &getClassName() const {
-    return className;
+    return *className;
   }
 
   const std::string &getFieldName() const {
-    return fieldName;
+    return *fieldName;
   }
 
   const std::string &getTypeName() const {
-    return typeName;
+    return type->javaName;
+  }
+
+  /**
+   * Stack slots used by a value of the field
+   */
+  uint8_t getTypeLength() const {
+    return type->length;
   }
 };
\ No newline at end of file
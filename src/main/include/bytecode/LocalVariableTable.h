@@ -16,4 +16,9 @@ public:
 
   //Bytecode manipulation tools may add local variables without altering LocalVariableTable
   std::optional<const std::tuple<std::string_view, std::string_view>> getEntry(uint16_t slot) const;
+
+  /**
+   * Continue hash over all entries, see ByteVectorUtil::hash
+   */
+  uint64_t hash(uint64_t hash) const;
 };
\ No newline at end of file
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "ByteView.h"
+
+/**
+ * Read-only memory mapping of a whole file, e.g. a class file read by offline tools.
+ * Views of the bytes are valid as long as the mapping.
+ */
+class MappedFile {
+  const uint8_t *bytes = nullptr;
+  size_t length = 0;
+#ifdef _WIN32
+  void *fileHandle = nullptr;
+  void *mappingHandle = nullptr;
+#endif
+
+  void unmap();
+
+public:
+  /**
+   * Throws std::runtime_error if the file can't be opened or mapped
+   */
+  explicit MappedFile(const std::string &path);
+
+  MappedFile(const MappedFile &) = delete;
+
+  MappedFile &operator=(const MappedFile &) = delete;
+
+  ~MappedFile();
+
+  ByteView getBytes() const { return ByteView(bytes, length); }
+};
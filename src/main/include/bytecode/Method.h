@@ -5,17 +5,24 @@
 
 #include "CodeAttribute.h"
 #include "ConstPool.h"
+#include "Symbols.h"
 
+/**
+ * Names and descriptor are interned in Symbols or owned elsewhere, copying a Method is cheap
+ */
 class Method {
   uint32_t modifiers;
-  std::string className;
-  std::string returnType;
-  std::string methodName;
-  std::string signature;
-  std::vector<std::string> parameterTypes;
-  uint8_t parameterLength;
+  const std::string *className;
+  const std::string *methodName;
+  const MethodDescriptor *descriptor;
 
 public:
+  /**
+   * Names are not copied, they must outlive the Method, e.g. interned or owned by a MethodCache record
+   */
+  Method(const std::string &className, const std::string &methodName, const MethodDescriptor &descriptor, uint32_t modifiers) :
+      modifiers(modifiers), className(&className), methodName(&methodName), descriptor(&descriptor) {}
+
   Method(std::string_view className, std::string_view methodName, std::string_view signature, uint32_t modifiers);
 
   static Method readFromCodeInvoke(const CodeAttribute &code, const ConstPool &constPool, size_t bci);
@@ -23,28 +30,35 @@ public:
   static Method readFromMemberRef(const ConstPool &constPool, size_t refId, uint32_t modifiers);
 
   std::string_view getClassName() const {
-    return className;
+    return *className;
   }
 
   std::string_view getReturnType() const {
-    return returnType;
+    return descriptor->returnType;
+  }
+
+  /**
+   * Stack slots used by the return value, 0 for void
+   */
+  uint8_t getReturnLength() const {
+    return descriptor->returnLength;
   }
 
   std::string_view getMethodName() const {
-    return methodName;
+    return *methodName;
   }
 
   std::string_view getMethodSignature() const {
-    return signature;
+    return descriptor->descriptor;
   }
 
   const std::vector<std::string> &getParameterTypes() const {
-    return parameterTypes;
+    return descriptor->parameterTypes;
   }
 
   uint8_t getParameterCount() const {
     // JVM §4.3.3: Max length 255 parameters
-    return static_cast<uint8_t>(parameterTypes.size());
+    return static_cast<uint8_t>(descriptor->parameterTypes.size());
   }
 
   /**
@@ -52,7 +66,7 @@ public:
    * A parameter of type long or double contributes two units to the length and a parameter of any other type contributes one unit
    */
   uint8_t getParameterLength() const {
-    return parameterLength;
+    return descriptor->parameterLength;
   }
 
   //region Method modifiers
@@ -0,0 +1,280 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+#include "Constants.h"
+
+/**
+ * Layout of the operands following an opcode, drives decoding and printing of instructions
+ */
+enum class Operands : uint8_t {
+  None,
+  // Unassigned opcode, instructions must not use it
+  Invalid,
+  // bipush
+  Byte,
+  // sipush
+  Short,
+  // ldc
+  ConstPool8,
+  // Constant pool index e.g. field and method references, classes
+  ConstPool16,
+  // Local variable slot, e.g. iload 4
+  Local,
+  // Slot encoded in the opcode, e.g. aload_1
+  ImplicitLocal,
+  // iinc: slot and signed increment
+  Increment,
+  Branch16,
+  Branch32,
+  TableSwitch,
+  LookupSwitch,
+  // Constant pool index, argument slot count and a zero byte
+  InvokeInterface,
+  // Constant pool index and two zero bytes
+  InvokeDynamic,
+  // newarray
+  ArrayType,
+  // Constant pool index and dimensions
+  MultiANewArray,
+  // Prefix widening the operands of the following instruction
+  Wide
+};
+
+/**
+ * Everything known about an opcode without looking at its operands
+ */
+struct OpcodeInfo {
+  // Stack effect or null-checked slot depends on the operands, e.g. the descriptor of an invoked method
+  static constexpr int8_t VARIES = -1;
+  static constexpr int8_t NO_NULL_CHECK = -2;
+
+  const char *mnemonic = "invalid";
+  // Instruction length including operands, 0 for wide and the switches whose length depends on their operands
+  uint8_t length = 0;
+  Operands operands = Operands::Invalid;
+  // Operand stack slots consumed and produced
+  int8_t pops = 0;
+  int8_t pushes = 0;
+  // Slots below the top of the stack of the reference the instruction throws an NPE for when it is null
+  int8_t nullCheckDepth = NO_NULL_CHECK;
+
+  constexpr bool canThrowNPE() const { return nullCheckDepth != NO_NULL_CHECK; }
+};
+
+constexpr std::array<OpcodeInfo, 256> makeOpcodeTable() {
+  std::array<OpcodeInfo, 256> table{};
+  table[OpCodes::NOP] = {"nop", 1, Operands::None, 0, 0};
+  table[OpCodes::ACONST_NULL] = {"aconst_null", 1, Operands::None, 0, 1};
+  table[OpCodes::ICONST_M1] = {"iconst_m1", 1, Operands::None, 0, 1};
+  table[OpCodes::ICONST_0] = {"iconst_0", 1, Operands::None, 0, 1};
+  table[OpCodes::ICONST_1] = {"iconst_1", 1, Operands::None, 0, 1};
+  table[OpCodes::ICONST_2] = {"iconst_2", 1, Operands::None, 0, 1};
+  table[OpCodes::ICONST_3] = {"iconst_3", 1, Operands::None, 0, 1};
+  table[OpCodes::ICONST_4] = {"iconst_4", 1, Operands::None, 0, 1};
+  table[OpCodes::ICONST_5] = {"iconst_5", 1, Operands::None, 0, 1};
+  table[OpCodes::LCONST_0] = {"lconst_0", 1, Operands::None, 0, 2};
+  table[OpCodes::LCONST_1] = {"lconst_1", 1, Operands::None, 0, 2};
+  table[OpCodes::FCONST_0] = {"fconst_0", 1, Operands::None, 0, 1};
+  table[OpCodes::FCONST_1] = {"fconst_1", 1, Operands::None, 0, 1};
+  table[OpCodes::FCONST_2] = {"fconst_2", 1, Operands::None, 0, 1};
+  table[OpCodes::DCONST_0] = {"dconst_0", 1, Operands::None, 0, 2};
+  table[OpCodes::DCONST_1] = {"dconst_1", 1, Operands::None, 0, 2};
+  table[OpCodes::BIPUSH] = {"bipush", 2, Operands::Byte, 0, 1};
+  table[OpCodes::SIPUSH] = {"sipush", 3, Operands::Short, 0, 1};
+  table[OpCodes::LDC] = {"ldc", 2, Operands::ConstPool8, 0, 1};
+  table[OpCodes::LDC_W] = {"ldc_w", 3, Operands::ConstPool16, 0, 1};
+  table[OpCodes::LDC2_W] = {"ldc2_w", 3, Operands::ConstPool16, 0, 2};
+  table[OpCodes::ILOAD] = {"iload", 2, Operands::Local, 0, 1};
+  table[OpCodes::LLOAD] = {"lload", 2, Operands::Local, 0, 2};
+  table[OpCodes::FLOAD] = {"fload", 2, Operands::Local, 0, 1};
+  table[OpCodes::DLOAD] = {"dload", 2, Operands::Local, 0, 2};
+  table[OpCodes::ALOAD] = {"aload", 2, Operands::Local, 0, 1};
+  table[OpCodes::ILOAD_0] = {"iload_0", 1, Operands::ImplicitLocal, 0, 1};
+  table[OpCodes::ILOAD_1] = {"iload_1", 1, Operands::ImplicitLocal, 0, 1};
+  table[OpCodes::ILOAD_2] = {"iload_2", 1, Operands::ImplicitLocal, 0, 1};
+  table[OpCodes::ILOAD_3] = {"iload_3", 1, Operands::ImplicitLocal, 0, 1};
+  table[OpCodes::LLOAD_0] = {"lload_0", 1, Operands::ImplicitLocal, 0, 2};
+  table[OpCodes::LLOAD_1] = {"lload_1", 1, Operands::ImplicitLocal, 0, 2};
+  table[OpCodes::LLOAD_2] = {"lload_2", 1, Operands::ImplicitLocal, 0, 2};
+  table[OpCodes::LLOAD_3] = {"lload_3", 1, Operands::ImplicitLocal, 0, 2};
+  table[OpCodes::FLOAD_0] = {"fload_0", 1, Operands::ImplicitLocal, 0, 1};
+  table[OpCodes::FLOAD_1] = {"fload_1", 1, Operands::ImplicitLocal, 0, 1};
+  table[OpCodes::FLOAD_2] = {"fload_2", 1, Operands::ImplicitLocal, 0, 1};
+  table[OpCodes::FLOAD_3] = {"fload_3", 1, Operands::ImplicitLocal, 0, 1};
+  table[OpCodes::DLOAD_0] = {"dload_0", 1, Operands::ImplicitLocal, 0, 2};
+  table[OpCodes::DLOAD_1] = {"dload_1", 1, Operands::ImplicitLocal, 0, 2};
+  table[OpCodes::DLOAD_2] = {"dload_2", 1, Operands::ImplicitLocal, 0, 2};
+  table[OpCodes::DLOAD_3] = {"dload_3", 1, Operands::ImplicitLocal, 0, 2};
+  table[OpCodes::ALOAD_0] = {"aload_0", 1, Operands::ImplicitLocal, 0, 1};
+  table[OpCodes::ALOAD_1] = {"aload_1", 1, Operands::ImplicitLocal, 0, 1};
+  table[OpCodes::ALOAD_2] = {"aload_2", 1, Operands::ImplicitLocal, 0, 1};
+  table[OpCodes::ALOAD_3] = {"aload_3", 1, Operands::ImplicitLocal, 0, 1};
+  table[OpCodes::IALOAD] = {"iaload", 1, Operands::None, 2, 1, 1};
+  table[OpCodes::LALOAD] = {"laload", 1, Operands::None, 2, 2, 1};
+  table[OpCodes::FALOAD] = {"faload", 1, Operands::None, 2, 1, 1};
+  table[OpCodes::DALOAD] = {"daload", 1, Operands::None, 2, 2, 1};
+  table[OpCodes::AALOAD] = {"aaload", 1, Operands::None, 2, 1, 1};
+  table[OpCodes::BALOAD] = {"baload", 1, Operands::None, 2, 1, 1};
+  table[OpCodes::CALOAD] = {"caload", 1, Operands::None, 2, 1, 1};
+  table[OpCodes::SALOAD] = {"saload", 1, Operands::None, 2, 1, 1};
+  table[OpCodes::ISTORE] = {"istore", 2, Operands::Local, 1, 0};
+  table[OpCodes::LSTORE] = {"lstore", 2, Operands::Local, 2, 0};
+  table[OpCodes::FSTORE] = {"fstore", 2, Operands::Local, 1, 0};
+  table[OpCodes::DSTORE] = {"dstore", 2, Operands::Local, 2, 0};
+  table[OpCodes::ASTORE] = {"astore", 2, Operands::Local, 1, 0};
+  table[OpCodes::ISTORE_0] = {"istore_0", 1, Operands::ImplicitLocal, 1, 0};
+  table[OpCodes::ISTORE_1] = {"istore_1", 1, Operands::ImplicitLocal, 1, 0};
+  table[OpCodes::ISTORE_2] = {"istore_2", 1, Operands::ImplicitLocal, 1, 0};
+  table[OpCodes::ISTORE_3] = {"istore_3", 1, Operands::ImplicitLocal, 1, 0};
+  table[OpCodes::LSTORE_0] = {"lstore_0", 1, Operands::ImplicitLocal, 2, 0};
+  table[OpCodes::LSTORE_1] = {"lstore_1", 1, Operands::ImplicitLocal, 2, 0};
+  table[OpCodes::LSTORE_2] = {"lstore_2", 1, Operands::ImplicitLocal, 2, 0};
+  table[OpCodes::LSTORE_3] = {"lstore_3", 1, Operands::ImplicitLocal, 2, 0};
+  table[OpCodes::FSTORE_0] = {"fstore_0", 1, Operands::ImplicitLocal, 1, 0};
+  table[OpCodes::FSTORE_1] = {"fstore_1", 1, Operands::ImplicitLocal, 1, 0};
+  table[OpCodes::FSTORE_2] = {"fstore_2", 1, Operands::ImplicitLocal, 1, 0};
+  table[OpCodes::FSTORE_3] = {"fstore_3", 1, Operands::ImplicitLocal, 1, 0};
+  table[OpCodes::DSTORE_0] = {"dstore_0", 1, Operands::ImplicitLocal, 2, 0};
+  table[OpCodes::DSTORE_1] = {"dstore_1", 1, Operands::ImplicitLocal, 2, 0};
+  table[OpCodes::DSTORE_2] = {"dstore_2", 1, Operands::ImplicitLocal, 2, 0};
+  table[OpCodes::DSTORE_3] = {"dstore_3", 1, Operands::ImplicitLocal, 2, 0};
+  table[OpCodes::ASTORE_0] = {"astore_0", 1, Operands::ImplicitLocal, 1, 0};
+  table[OpCodes::ASTORE_1] = {"astore_1", 1, Operands::ImplicitLocal, 1, 0};
+  table[OpCodes::ASTORE_2] = {"astore_2", 1, Operands::ImplicitLocal, 1, 0};
+  table[OpCodes::ASTORE_3] = {"astore_3", 1, Operands::ImplicitLocal, 1, 0};
+  table[OpCodes::IASTORE] = {"iastore", 1, Operands::None, 3, 0, 2};
+  table[OpCodes::LASTORE] = {"lastore", 1, Operands::None, 4, 0, 3};
+  table[OpCodes::FASTORE] = {"fastore", 1, Operands::None, 3, 0, 2};
+  table[OpCodes::DASTORE] = {"dastore", 1, Operands::None, 4, 0, 3};
+  table[OpCodes::AASTORE] = {"aastore", 1, Operands::None, 3, 0, 2};
+  table[OpCodes::BASTORE] = {"bastore", 1, Operands::None, 3, 0, 2};
+  table[OpCodes::CASTORE] = {"castore", 1, Operands::None, 3, 0, 2};
+  table[OpCodes::SASTORE] = {"sastore", 1, Operands::None, 3, 0, 2};
+  table[OpCodes::POP] = {"pop", 1, Operands::None, 1, 0};
+  table[OpCodes::POP2] = {"pop2", 1, Operands::None, 2, 0};
+  table[OpCodes::DUP] = {"dup", 1, Operands::None, 1, 2};
+  table[OpCodes::DUP_X1] = {"dup_x1", 1, Operands::None, 2, 3};
+  table[OpCodes::DUP_X2] = {"dup_x2", 1, Operands::None, 3, 4};
+  table[OpCodes::DUP2] = {"dup2", 1, Operands::None, 2, 4};
+  table[OpCodes::DUP2_X1] = {"dup2_x1", 1, Operands::None, 3, 5};
+  table[OpCodes::DUP2_X2] = {"dup2_x2", 1, Operands::None, 4, 6};
+  table[OpCodes::SWAP] = {"swap", 1, Operands::None, 2, 2};
+  table[OpCodes::IADD] = {"iadd", 1, Operands::None, 2, 1};
+  table[OpCodes::LADD] = {"ladd", 1, Operands::None, 4, 2};
+  table[OpCodes::FADD] = {"fadd", 1, Operands::None, 2, 1};
+  table[OpCodes::DADD] = {"dadd", 1, Operands::None, 4, 2};
+  table[OpCodes::ISUB] = {"isub", 1, Operands::None, 2, 1};
+  table[OpCodes::LSUB] = {"lsub", 1, Operands::None, 4, 2};
+  table[OpCodes::FSUB] = {"fsub", 1, Operands::None, 2, 1};
+  table[OpCodes::DSUB] = {"dsub", 1, Operands::None, 4, 2};
+  table[OpCodes::IMUL] = {"imul", 1, Operands::None, 2, 1};
+  table[OpCodes::LMUL] = {"lmul", 1, Operands::None, 4, 2};
+  table[OpCodes::FMUL] = {"fmul", 1, Operands::None, 2, 1};
+  table[OpCodes::DMUL] = {"dmul", 1, Operands::None, 4, 2};
+  table[OpCodes::IDIV] = {"idiv", 1, Operands::None, 2, 1};
+  table[OpCodes::LDIV] = {"ldiv", 1, Operands::None, 4, 2};
+  table[OpCodes::FDIV] = {"fdiv", 1, Operands::None, 2, 1};
+  table[OpCodes::DDIV] = {"ddiv", 1, Operands::None, 4, 2};
+  table[OpCodes::IREM] = {"irem", 1, Operands::None, 2, 1};
+  table[OpCodes::LREM] = {"lrem", 1, Operands::None, 4, 2};
+  table[OpCodes::FREM] = {"frem", 1, Operands::None, 2, 1};
+  table[OpCodes::DREM] = {"drem", 1, Operands::None, 4, 2};
+  table[OpCodes::INEG] = {"ineg", 1, Operands::None, 1, 1};
+  table[OpCodes::LNEG] = {"lneg", 1, Operands::None, 2, 2};
+  table[OpCodes::FNEG] = {"fneg", 1, Operands::None, 1, 1};
+  table[OpCodes::DNEG] = {"dneg", 1, Operands::None, 2, 2};
+  table[OpCodes::ISHL] = {"ishl", 1, Operands::None, 2, 1};
+  table[OpCodes::LSHL] = {"lshl", 1, Operands::None, 3, 2};
+  table[OpCodes::ISHR] = {"ishr", 1, Operands::None, 2, 1};
+  table[OpCodes::LSHR] = {"lshr", 1, Operands::None, 3, 2};
+  table[OpCodes::IUSHR] = {"iushr", 1, Operands::None, 2, 1};
+  table[OpCodes::LUSHR] = {"lushr", 1, Operands::None, 3, 2};
+  table[OpCodes::IAND] = {"iand", 1, Operands::None, 2, 1};
+  table[OpCodes::LAND] = {"land", 1, Operands::None, 4, 2};
+  table[OpCodes::IOR] = {"ior", 1, Operands::None, 2, 1};
+  table[OpCodes::LOR] = {"lor", 1, Operands::None, 4, 2};
+  table[OpCodes::IXOR] = {"ixor", 1, Operands::None, 2, 1};
+  table[OpCodes::LXOR] = {"lxor", 1, Operands::None, 4, 2};
+  table[OpCodes::IINC] = {"iinc", 3, Operands::Increment, 0, 0};
+  table[OpCodes::I2L] = {"i2l", 1, Operands::None, 1, 2};
+  table[OpCodes::I2F] = {"i2f", 1, Operands::None, 1, 1};
+  table[OpCodes::I2D] = {"i2d", 1, Operands::None, 1, 2};
+  table[OpCodes::L2I] = {"l2i", 1, Operands::None, 2, 1};
+  table[OpCodes::L2F] = {"l2f", 1, Operands::None, 2, 1};
+  table[OpCodes::L2D] = {"l2d", 1, Operands::None, 2, 2};
+  table[OpCodes::F2I] = {"f2i", 1, Operands::None, 1, 1};
+  table[OpCodes::F2L] = {"f2l", 1, Operands::None, 1, 2};
+  table[OpCodes::F2D] = {"f2d", 1, Operands::None, 1, 2};
+  table[OpCodes::D2I] = {"d2i", 1, Operands::None, 2, 1};
+  table[OpCodes::D2L] = {"d2l", 1, Operands::None, 2, 2};
+  table[OpCodes::D2F] = {"d2f", 1, Operands::None, 2, 1};
+  table[OpCodes::I2B] = {"i2b", 1, Operands::None, 1, 1};
+  table[OpCodes::I2C] = {"i2c", 1, Operands::None, 1, 1};
+  table[OpCodes::I2S] = {"i2s", 1, Operands::None, 1, 1};
+  table[OpCodes::LCMP] = {"lcmp", 1, Operands::None, 4, 1};
+  table[OpCodes::FCMPL] = {"fcmpl", 1, Operands::None, 2, 1};
+  table[OpCodes::FCMPG] = {"fcmpg", 1, Operands::None, 2, 1};
+  table[OpCodes::DCMPL] = {"dcmpl", 1, Operands::None, 4, 1};
+  table[OpCodes::DCMPG] = {"dcmpg", 1, Operands::None, 4, 1};
+  table[OpCodes::IFEQ] = {"ifeq", 3, Operands::Branch16, 1, 0};
+  table[OpCodes::IFNE] = {"ifne", 3, Operands::Branch16, 1, 0};
+  table[OpCodes::IFLT] = {"iflt", 3, Operands::Branch16, 1, 0};
+  table[OpCodes::IFGE] = {"ifge", 3, Operands::Branch16, 1, 0};
+  table[OpCodes::IFGT] = {"ifgt", 3, Operands::Branch16, 1, 0};
+  table[OpCodes::IFLE] = {"ifle", 3, Operands::Branch16, 1, 0};
+  table[OpCodes::IF_ICMPEQ] = {"if_icmpeq", 3, Operands::Branch16, 2, 0};
+  table[OpCodes::IF_ICMPNE] = {"if_icmpne", 3, Operands::Branch16, 2, 0};
+  table[OpCodes::IF_ICMPLT] = {"if_icmplt", 3, Operands::Branch16, 2, 0};
+  table[OpCodes::IF_ICMPGE] = {"if_icmpge", 3, Operands::Branch16, 2, 0};
+  table[OpCodes::IF_ICMPGT] = {"if_icmpgt", 3, Operands::Branch16, 2, 0};
+  table[OpCodes::IF_ICMPLE] = {"if_icmple", 3, Operands::Branch16, 2, 0};
+  table[OpCodes::IF_ACMPEQ] = {"if_acmpeq", 3, Operands::Branch16, 2, 0};
+  table[OpCodes::IF_ACMPNE] = {"if_acmpne", 3, Operands::Branch16, 2, 0};
+  table[OpCodes::GOTO] = {"goto", 3, Operands::Branch16, 0, 0};
+  table[OpCodes::JSR] = {"jsr", 3, Operands::Branch16, 0, 1};
+  table[OpCodes::RET] = {"ret", 2, Operands::Local, 0, 0};
+  table[OpCodes::TABLESWITCH] = {"tableswitch", 0, Operands::TableSwitch, 1, 0};
+  table[OpCodes::LOOKUPSWITCH] = {"lookupswitch", 0, Operands::LookupSwitch, 1, 0};
+  table[OpCodes::IRETURN] = {"ireturn", 1, Operands::None, 1, 0};
+  table[OpCodes::LRETURN] = {"lreturn", 1, Operands::None, 2, 0};
+  table[OpCodes::FRETURN] = {"freturn", 1, Operands::None, 1, 0};
+  table[OpCodes::DRETURN] = {"dreturn", 1, Operands::None, 2, 0};
+  table[OpCodes::ARETURN] = {"areturn", 1, Operands::None, 1, 0};
+  table[OpCodes::RETURN] = {"return", 1, Operands::None, 0, 0};
+  table[OpCodes::GETSTATIC] = {"getstatic", 3, Operands::ConstPool16, OpcodeInfo::VARIES, OpcodeInfo::VARIES};
+  table[OpCodes::PUTSTATIC] = {"putstatic", 3, Operands::ConstPool16, OpcodeInfo::VARIES, OpcodeInfo::VARIES};
+  table[OpCodes::GETFIELD] = {"getfield", 3, Operands::ConstPool16, OpcodeInfo::VARIES, OpcodeInfo::VARIES, 0};
+  table[OpCodes::PUTFIELD] = {"putfield", 3, Operands::ConstPool16, OpcodeInfo::VARIES, OpcodeInfo::VARIES, OpcodeInfo::VARIES};
+  table[OpCodes::INVOKEVIRTUAL] = {"invokevirtual", 3, Operands::ConstPool16, OpcodeInfo::VARIES, OpcodeInfo::VARIES, OpcodeInfo::VARIES};
+  table[OpCodes::INVOKESPECIAL] = {"invokespecial", 3, Operands::ConstPool16, OpcodeInfo::VARIES, OpcodeInfo::VARIES, OpcodeInfo::VARIES};
+  table[OpCodes::INVOKESTATIC] = {"invokestatic", 3, Operands::ConstPool16, OpcodeInfo::VARIES, OpcodeInfo::VARIES};
+  table[OpCodes::INVOKEINTERFACE] = {"invokeinterface", 5, Operands::InvokeInterface, OpcodeInfo::VARIES, OpcodeInfo::VARIES, OpcodeInfo::VARIES};
+  table[OpCodes::INVOKEDYNAMIC] = {"invokedynamic", 5, Operands::InvokeDynamic, OpcodeInfo::VARIES, OpcodeInfo::VARIES};
+  table[OpCodes::NEW] = {"new", 3, Operands::ConstPool16, 0, 1};
+  table[OpCodes::NEWARRAY] = {"newarray", 2, Operands::ArrayType, 1, 1};
+  table[OpCodes::ANEWARRAY] = {"anewarray", 3, Operands::ConstPool16, 1, 1};
+  table[OpCodes::ARRAYLENGTH] = {"arraylength", 1, Operands::None, 1, 1, 0};
+  table[OpCodes::ATHROW] = {"athrow", 1, Operands::None, 1, 0, 0};
+  table[OpCodes::CHECKCAST] = {"checkcast", 3, Operands::ConstPool16, 1, 1};
+  table[OpCodes::INSTANCEOF] = {"instanceof", 3, Operands::ConstPool16, 1, 1};
+  table[OpCodes::MONITORENTER] = {"monitorenter", 1, Operands::None, 1, 0, 0};
+  table[OpCodes::MONITOREXIT] = {"monitorexit", 1, Operands::None, 1, 0, 0};
+  table[OpCodes::WIDE] = {"wide", 0, Operands::Wide, OpcodeInfo::VARIES, OpcodeInfo::VARIES};
+  table[OpCodes::MULTIANEWARRAY] = {"multianewarray", 4, Operands::MultiANewArray, OpcodeInfo::VARIES, OpcodeInfo::VARIES};
+  table[OpCodes::IFNULL] = {"ifnull", 3, Operands::Branch16, 1, 0};
+  table[OpCodes::IFNONNULL] = {"ifnonnull", 3, Operands::Branch16, 1, 0};
+  table[OpCodes::GOTO_W] = {"goto_w", 5, Operands::Branch32, 0, 0};
+  table[OpCodes::JSR_W] = {"jsr_w", 5, Operands::Branch32, 0, 1};
+  return table;
+}
+
+inline constexpr std::array<OpcodeInfo, 256> OpcodeTable = makeOpcodeTable();
+
+constexpr const OpcodeInfo &opcodeInfo(uint8_t opCode) {
+  return OpcodeTable[opCode];
+}
+
+static_assert(opcodeInfo(OpCodes::JSR_W).length == 5 && opcodeInfo(OpCodes::JSR_W + 1).operands == Operands::Invalid,
+              "Opcode table is out of sync with OpCodes");
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include "CodeAttribute.h"
+#include "ConstPool.h"
+#include "ControlFlowGraph.h"
+#include "StackMapTable.h"
+
+/**
+ * Forward data flow analysis of the operand stack, tracking which instruction pushed each stack slot.
+ * Where control flow joins, a slot pushed by different instructions on different paths becomes UNKNOWN,
+ * unless the instructions are identical e.g. the same local variable loaded in both branches.
+ * Instructions that only pass a reference through, e.g. dup, swap and checkcast, keep the original producer.
+ *
+ * Handlers of the exception table start with only the caught exception on the stack. Without the exception table,
+ * e.g. for code from JVMTI, the first block unreachable by normal control flow is assumed to be a handler, which holds
+ * for javac's layout.
+ * The code and constant pool must outlive the analysis, its Flow does not depend on them and can be reused.
+ */
+class StackAnalysis {
+public:
+  static constexpr uint32_t UNKNOWN = UINT32_MAX;
+  static constexpr uint32_t CAUGHT_EXCEPTION = UINT32_MAX - 1;
+  // Slot was already on the stack at the StackMapTable frame a replay started from
+  static constexpr uint32_t FRAME_ENTRY = UINT32_MAX - 2;
+
+  /**
+   * Result of analyzing a method: its blocks and the stack at the start of each
+   */
+  struct Flow {
+    ControlFlowGraph cfg;
+    // Empty optional if the block is not reached
+    std::vector<std::optional<std::vector<uint32_t>>> entryStacks;
+  };
+
+  /**
+   * @param handlerPcs handler offsets of the exception table, null if the table is not known
+   */
+  StackAnalysis(const CodeAttribute &code, const ConstPool &constPool,
+                const std::vector<uint16_t> *handlerPcs = nullptr);
+
+  /**
+   * Reuse the flow of an earlier analysis of the same code, nothing is analyzed again
+   */
+  StackAnalysis(const CodeAttribute &code, const ConstPool &constPool, std::shared_ptr<const Flow> flow);
+
+  const std::shared_ptr<const Flow> &getFlow() const { return flow; }
+
+  /**
+   * Offset of the instruction that pushed a stack slot, as seen right before the instruction at offset executes
+   * @param depth slots below the top of the stack, 0 is the top
+   * @return offset of the producer, UNKNOWN or CAUGHT_EXCEPTION
+   */
+  uint32_t getProducer(size_t offset, size_t depth) const;
+
+  /**
+   * Call visitor(offset, stack) with the producers on the stack right before each reachable instruction executes.
+   * Replays every block once, unlike calling getProducer for each instruction.
+   */
+  template<typename Visitor>
+  void visitInstructions(Visitor &&visitor) const {
+    const std::vector<BasicBlock> &blocks = flow->cfg.getBlocks();
+    for (size_t index = 0; index < blocks.size(); index++) {
+      if (!flow->entryStacks[index].has_value()) { continue; }
+
+      std::vector<uint32_t> stack = *flow->entryStacks[index];
+      for (size_t offset = blocks[index].start; offset < blocks[index].end; offset += code.getInstructionLength(offset)) {
+        visitor(offset, static_cast<const std::vector<uint32_t> &>(stack));
+        execute(code, constPool, offset, stack);
+      }
+    }
+  }
+
+  const ControlFlowGraph &getControlFlowGraph() const { return flow->cfg; }
+
+  /**
+   * Like getProducer, but only replays the straight-line code from frame to offset without analyzing the method.
+   * Code between a frame and the next one is only entered at the frame, so frame must be the last one before offset.
+   * @return offset of the producer, or FRAME_ENTRY if the slot was pushed before the frame
+   */
+  static uint32_t getProducerAfterFrame(const CodeAttribute &code, const ConstPool &constPool,
+                                        const StackMapFrame &frame, size_t offset, size_t depth);
+
+private:
+  const CodeAttribute &code;
+  const ConstPool &constPool;
+  std::shared_ptr<const Flow> flow;
+
+  void analyze(Flow &result, const std::vector<uint16_t> *handlerPcs) const;
+
+  bool merge(Flow &result, size_t blockIndex, const std::vector<uint32_t> &stack) const;
+
+  bool isSameInstruction(uint32_t first, uint32_t second) const;
+
+  /**
+   * Apply the effect of the instruction at offset to the stack
+   */
+  static void execute(const CodeAttribute &code, const ConstPool &constPool, size_t offset,
+                      std::vector<uint32_t> &stack);
+
+  /**
+   * Slots popped and pushed by instructions whose stack effect depends on their operands
+   */
+  static std::pair<int, int> operandStackEffect(const CodeAttribute &code, const ConstPool &constPool, size_t offset,
+                                                uint8_t opCode);
+};
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "ByteView.h"
+
+/**
+ * Operand stack height at a StackMapTable frame, long and double count as two slots
+ */
+struct StackMapFrame {
+  uint16_t offset;
+  uint16_t stackSlots;
+};
+
+/**
+ * Frames of a StackMapTable attribute, JVMS §4.7.4. Only the height of the operand stack is kept,
+ * local variable types are not needed to find the producer of a stack slot.
+ * Every branch target and exception handler has a frame, so the code between a frame and the next one is entered
+ * only at the frame.
+ */
+class StackMapTable {
+  // Sorted by offset, starts with the implicit frame at offset 0 with an empty stack
+  std::vector<StackMapFrame> frames{StackMapFrame{0, 0}};
+
+public:
+  /**
+   * Table of a method without a StackMapTable attribute, i.e. without branches
+   */
+  StackMapTable() = default;
+
+  /**
+   * Parse the attribute info, without the 6 byte attribute header, starting at offset
+   */
+  StackMapTable(ByteView bytes, size_t offset, uint32_t length);
+
+  /**
+   * The last frame at or before location
+   */
+  const StackMapFrame &findFrameBefore(size_t location) const;
+
+  const std::vector<StackMapFrame> &getFrames() const { return frames; }
+};
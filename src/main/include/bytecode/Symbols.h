@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+/**
+ * Field type or class name with its Java readable form
+ */
+struct TypeDescriptor {
+  std::string descriptor;  // e.g. Ljava/lang/String; or [I, class names in internal form e.g. java/lang/String
+  std::string javaName;    // e.g. java.lang.String or int[]
+  uint8_t length;          // Stack and local variable slots used by a value of this type
+};
+
+struct MethodDescriptor {
+  std::string descriptor;
+  std::vector<std::string> parameterTypes;
+  std::string returnType;
+  uint8_t parameterLength; // Sum of parameter slots, see Method::getParameterLength
+  uint8_t returnLength;    // Stack slots used by the return value, 0 for void
+};
+
+/**
+ * Process-wide interner of names and parsed descriptors.
+ * Each distinct string is parsed once, returned references stay valid for the lifetime of the agent.
+ * Safe to use from multiple threads.
+ *
+ * Symbols are never freed, so only names read from analyzed code and method descriptors are interned, which grow with
+ * the code that throws NPEs. Names of the classes and methods on the stack are owned by MethodCache records, which
+ * are evicted with their class.
+ */
+class Symbols {
+public:
+  static const std::string &intern(std::string_view symbol);
+
+  /**
+   * @param internalName class name in internal form, e.g. java/lang/String
+   */
+  static const TypeDescriptor &className(std::string_view internalName);
+
+  /**
+   * @param descriptor field descriptor as described in JVMS §4.3.2, e.g. Ljava/lang/String;
+   */
+  static const TypeDescriptor &fieldType(std::string_view descriptor);
+
+  /**
+   * @param descriptor method descriptor as described in JVMS §4.3.3, e.g. (ILjava/lang/String;)V
+   */
+  static const MethodDescriptor &methodDescriptor(std::string_view descriptor);
+
+  static size_t size();
+};
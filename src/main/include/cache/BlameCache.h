@@ -0,0 +1,79 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <jvmti.h>
+
+/**
+ * Concurrent cache of finished NPE descriptions per throw site.
+ * Concurrent misses for the same site are computed once, other threads wait for the result (single-flight).
+ */
+class BlameCache {
+public:
+  // nullopt marks a site that should not be described, e.g. an explicitly constructed NPE
+  using Description = std::optional<std::string>;
+  using Key = std::pair<jmethodID, jlocation>;
+
+  explicit BlameCache(size_t maxSize);
+
+  /**
+   * Get the cached description for the site or compute and cache it.
+   * If compute throws, the site is not cached and the exception is rethrown in all waiting threads.
+   */
+  Description getOrCompute(jmethodID method, jlocation location, const std::function<Description()> &compute);
+
+  /**
+   * Remove all sites in the methods, e.g. of unloaded classes
+   * @return number of removed sites
+   */
+  size_t evict(const std::unordered_set<jmethodID> &methods);
+
+  void clear();
+
+  size_t size() const;
+
+  uint64_t getHits() const { return hits.load(std::memory_order_relaxed); }
+
+  uint64_t getMisses() const { return misses.load(std::memory_order_relaxed); }
+
+  static BlameCache &instance();
+
+private:
+  static const size_t SHARD_COUNT = 16;
+
+  struct KeyHash {
+    size_t operator()(const Key &key) const {
+      return std::hash<jmethodID>()(key.first) * 31 + std::hash<jlocation>()(key.second);
+    }
+  };
+
+  struct Entry {
+    std::shared_future<Description> future;
+    // Tells the entry inserted by a computation from one inserted after it was evicted
+    uint64_t ticket;
+  };
+
+  struct Shard {
+    mutable std::mutex mutex;
+    std::unordered_map<Key, Entry, KeyHash> entries;
+    uint64_t nextTicket = 0;
+  };
+
+  Shard &shardFor(const Key &key) { return shards[KeyHash()(key) % SHARD_COUNT]; }
+
+  void evictOne(Shard &shard);
+
+  size_t maxShardSize;
+  std::array<Shard, SHARD_COUNT> shards;
+  std::atomic<uint64_t> hits{0};
+  std::atomic<uint64_t> misses{0};
+};
@@ -0,0 +1,126 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "bytecode/ByteView.h"
+#include "bytecode/MappedFile.h"
+
+/**
+ * NPE descriptions of all methods of an application, built offline by npeblame-indexer and mapped by the agent.
+ * Methods are keyed by internal class name, method name and descriptor, e.g. java/lang/String.trim()Ljava/lang/String;
+ * and carry the hash of their code, resolved constant pool references and local variables (see hashMethodCode),
+ * a method whose loaded code or references differ is not served from the index.
+ *
+ * File layout, native byte order, sections 8 byte aligned:
+ * Header | MethodRecord[methodCount] sorted by key | SiteRecord[siteCount] sorted by location per method | strings
+ */
+class BlameIndex {
+public:
+  static constexpr uint32_t VERSION = 2;
+
+  struct MethodRecord {
+    uint64_t codeHash;
+    uint32_t keyOffset;
+    uint32_t keyLength;
+    uint32_t firstSite;
+    uint32_t siteCount;
+  };
+
+  /**
+   * Collects methods and writes them as an index, identical descriptions are stored once
+   */
+  class Builder {
+  public:
+    /**
+     * @param sites location and description of each instruction that can throw an NPE, ordered by location
+     */
+    void addMethod(std::string key, uint64_t codeHash, std::vector<std::pair<size_t, std::string>> sites);
+
+    size_t size() const { return methods.size(); }
+
+    /**
+     * Sort the methods and write the index to a temporary file renamed to path, readers never see a partial index.
+     * Throws std::runtime_error on I/O errors or duplicate keys
+     */
+    void write(const std::string &path);
+
+  private:
+    struct IndexedMethod {
+      std::string key;
+      uint64_t codeHash;
+      std::vector<std::pair<size_t, std::string>> sites;
+    };
+
+    std::vector<IndexedMethod> methods;
+  };
+
+  /**
+   * Map and validate an index, throws std::runtime_error if it can't be read or has another version
+   */
+  explicit BlameIndex(const std::string &path);
+
+  static std::string methodKey(std::string_view className, std::string_view methodName, std::string_view descriptor);
+
+  /**
+   * @return null if the method is not in the index or was indexed from other code
+   */
+  const MethodRecord *findMethod(std::string_view key, uint64_t codeHash) const;
+
+  /**
+   * Description of the instruction at location, empty if it cannot throw an NPE.
+   * The view lives as long as the index.
+   */
+  std::optional<std::string_view> findSite(const MethodRecord &method, size_t location) const;
+
+  /**
+   * Location and description of every site of the method, ordered by location
+   */
+  std::vector<std::pair<size_t, std::string>> getSites(const MethodRecord &method) const;
+
+  std::string_view getKey(const MethodRecord &method) const {
+    return getString(method.keyOffset, method.keyLength);
+  }
+
+  const MethodRecord *begin() const { return methods; }
+
+  const MethodRecord *end() const { return methods + methodCount; }
+
+  /**
+   * Number of methods
+   */
+  size_t size() const { return methodCount; }
+
+  size_t getSiteCount() const { return siteCount; }
+
+  /**
+   * Index given with the index option, null if none was loaded
+   */
+  static const BlameIndex *get();
+
+  /**
+   * Load the index used by get(), logs and keeps none if it can't be loaded
+   */
+  static void load(const std::string &path);
+
+private:
+  struct SiteRecord {
+    uint32_t location;
+    uint32_t descriptionOffset;
+    uint32_t descriptionLength;
+  };
+
+  std::unique_ptr<MappedFile> file;
+  const MethodRecord *methods = nullptr;
+  const SiteRecord *sites = nullptr;
+  ByteView strings;
+  size_t methodCount = 0;
+  size_t siteCount = 0;
+
+  std::string_view getString(uint32_t offset, uint32_t length) const;
+};
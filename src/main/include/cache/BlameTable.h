@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+#include <jvmti.h>
+
+/**
+ * Descriptions of all instructions of one method that can throw an NPE, sorted by location.
+ * Entries are fixed size and point into one shared buffer, identical descriptions are stored once.
+ */
+class BlameTable {
+public:
+  /**
+   * @param locatedDescriptions location and description of each instruction, ordered by location
+   */
+  explicit BlameTable(const std::vector<std::pair<size_t, std::string>> &locatedDescriptions);
+
+  /**
+   * Description of the instruction at location, empty if it cannot throw an NPE.
+   * The view lives as long as the table.
+   */
+  std::optional<std::string_view> find(size_t location) const;
+
+  size_t size() const { return entries.size(); }
+
+  /**
+   * Bytes allocated by the table, including the table object itself
+   */
+  size_t memoryUsage() const;
+
+private:
+  struct Entry {
+    uint32_t location;
+    uint32_t descriptionOffset;
+    uint32_t descriptionLength;
+  };
+
+  std::vector<Entry> entries;
+  std::string descriptions;
+};
+
+/**
+ * Blame tables of methods that threw an NPE, built on the first NPE in the method
+ */
+class BlameTableCache {
+public:
+  /**
+   * Get the table of the method or build and cache it. Concurrent builds for the same method may both run,
+   * the first one to finish is kept.
+   */
+  static std::shared_ptr<const BlameTable> get(jmethodID method, const std::function<BlameTable()> &build);
+
+  /**
+   * Remove the tables of the methods, e.g. of unloaded classes
+   * @return number of removed tables
+   */
+  static size_t evict(const std::unordered_set<jmethodID> &methods);
+
+  static size_t size();
+
+  /**
+   * Bytes allocated by all cached tables
+   */
+  static size_t memoryUsage();
+};
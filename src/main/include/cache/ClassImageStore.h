@@ -0,0 +1,101 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string_view>
+#include <vector>
+#include <jvmti.h>
+
+#include "bytecode/ByteView.h"
+#include "bytecode/ClassFile.h"
+#include "bytecode/ConstPool.h"
+#include "bytecode/LocalVariableTable.h"
+#include "bytecode/StackMapTable.h"
+
+/**
+ * Code of one method with the attributes the analysis uses, the code points into the class image
+ */
+struct MethodImage {
+  uint16_t nameIndex;
+  uint16_t descriptorIndex;
+  ByteView code;
+  // ByteVectorUtil::hash of the code, tells whether the loaded code is still the one in the image
+  uint64_t codeHash;
+  LocalVariableTable localVariables;
+  StackMapTable stackMap;
+  // handler_pc of each exception table entry
+  std::vector<uint16_t> handlerPcs;
+};
+
+/**
+ * Constant pool and method code of a class as they were in the class file, a replacement for
+ * GetConstantPool, GetBytecodes and GetLocalVariableTable. The constant pool and code are read in place from
+ * the class bytes owned by the image.
+ */
+class ClassImage {
+  std::vector<uint8_t> bytes;
+  ConstPool constPool;
+  std::vector<MethodImage> methods;
+
+public:
+  explicit ClassImage(std::vector<uint8_t> classBytes);
+
+  ClassImage(const ClassImage &) = delete;
+
+  ClassImage &operator=(const ClassImage &) = delete;
+
+  const ConstPool &getConstPool() const { return constPool; }
+
+  /**
+   * @return the method, null if the class has no such method with code
+   */
+  const MethodImage *findMethod(std::string_view name, std::string_view descriptor) const;
+};
+
+/**
+ * Class files captured at load time, reduced to the constant pool and the Code attributes of methods with their
+ * LocalVariableTable and StackMapTable. Images are compressed if the agent was built with zlib
+ * and identical images, e.g. the same library in several class loaders, are stored once.
+ *
+ * Classes are identified by their loader id of ClassRegistry and name, images are evicted when their loader
+ * is collected.
+ * Images are unpacked on lookup, only the first NPE at a site pays for it.
+ */
+class ClassImageStore {
+public:
+  /**
+   * Store the image of a class file from ClassFileLoadHook, replacing an earlier image of the same class.
+   * The image is dropped if the store would exceed its memory limit.
+   * @param loader null for the boot loader
+   */
+  static void record(jobject loader, const ClassFile &classFile);
+
+  /**
+   * @param className internal form, e.g. java/lang/String
+   * @return the unpacked image, null if the class was loaded before the agent or did not fit in memory
+   */
+  static std::shared_ptr<const ClassImage> find(jobject loader, std::string_view className);
+
+  /**
+   * Remove the images of a collected loader
+   * @return number of removed images
+   */
+  static size_t evictLoader(jlong loaderId);
+
+  /**
+   * Maximum bytes of stored images, taken from the classImageMemory option
+   */
+  static size_t memoryLimit();
+
+  static size_t size();
+
+  /**
+   * Bytes of stored images, shared images are counted once
+   */
+  static size_t memoryUsage();
+
+  /**
+   * Number of images dropped because of the memory limit
+   */
+  static size_t rejected();
+};
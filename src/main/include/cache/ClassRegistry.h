@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <jvmti.h>
+
+/**
+ * Compact handles for classes and ids for class loaders, stored as JVMTI tags. Handles are small positive numbers,
+ * reused once their class is unloaded, so per-class state lives in vectors indexed by handle and identifying a class
+ * costs a GetTag instead of running Class.getName. Loaders get negative ids.
+ *
+ * When a tagged class or loader is collected its entries are evicted from every cache. Caches keyed by jmethodID
+ * must be cleared this way too, the id of a method in an unloaded class may be reused for another method.
+ * ObjectFree may be sent during GC, where taking a cache lock could deadlock with a thread that holds it while
+ * paused in a JVMTI call. The event only queues the tag, the caches are evicted by the next evictUnloaded().
+ */
+class ClassRegistry {
+public:
+  /**
+   * Handle of the class, tagging it on first use
+   */
+  static jlong handle(jclass klass);
+
+  /**
+   * @param assign tag the loader if it has no id yet, otherwise return 0
+   * @return 0 for the boot loader, which is never collected
+   */
+  static jlong loaderId(jobject loader, bool assign);
+
+  /**
+   * Name as returned by Class.getName, e.g. java.lang.String, without running Java code
+   */
+  static std::string getClassName(jclass klass);
+
+  /**
+   * Name as in class files, e.g. java/lang/String
+   */
+  static std::string getInternalClassName(jclass klass);
+
+  /**
+   * Evict the entries of the method's class once it is unloaded, call before caching anything for the method
+   */
+  static void trackMethod(jmethodID method);
+
+  /**
+   * Evict entries of classes and loaders collected since the last call and release their handles,
+   * cheap if there are none
+   */
+  static void evictUnloaded();
+
+  /**
+   * Evict the entries of a class that was redefined or retransformed, the class keeps its handle. Its methods keep
+   * their jmethodIDs, so a redefinition is noticed on lookup when a method's code no longer hashes to its record in
+   * MethodCache
+   */
+  static void evictRedefined(jclass klass);
+
+  /**
+   * Number of cache entries evicted because their class or loader was collected, or their class redefined
+   */
+  static size_t evicted();
+
+  /**
+   * Number of classes with a handle
+   */
+  static size_t size();
+
+  static void JNICALL objectFree(jvmtiEnv *jvmti, jlong tag);
+};
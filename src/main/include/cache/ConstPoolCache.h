@@ -0,0 +1,22 @@
+#pragma once
+
+#include <memory>
+#include <jvmti.h>
+
+#include "bytecode/ConstPool.h"
+
+/**
+ * Constant pools of loaded classes, so that each pool is fetched from JVMTI and indexed only once.
+ * Pools are kept in a vector indexed by the class handle of ClassRegistry and evicted when the class is unloaded.
+ */
+class ConstPoolCache {
+public:
+  static std::shared_ptr<const ConstPool> get(jclass klass);
+
+  /**
+   * @return number of evicted pools
+   */
+  static size_t evict(jlong handle);
+
+  static size_t size();
+};
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <unordered_set>
+#include <jvmti.h>
+
+#include "cache/BlameIndex.h"
+
+/**
+ * Record of each method in the index option, or none if the method is not indexed or was indexed from other code.
+ * Matching a method hashes its whole code and the constant pool entries it refers to, this is done once per method
+ * instead of on every NPE site that misses the BlameCache.
+ */
+class IndexedMethodCache {
+public:
+  /**
+   * Get the record of the method or look it up and cache it, null if the method is not served from the index
+   */
+  static const BlameIndex::MethodRecord *get(jmethodID method,
+                                             const std::function<const BlameIndex::MethodRecord *()> &lookup);
+
+  /**
+   * Remove the records of the methods, e.g. of unloaded or redefined classes
+   * @return number of removed records
+   */
+  static size_t evict(const std::unordered_set<jmethodID> &methods);
+
+  static size_t size();
+};
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <unordered_set>
+#include <jvmti.h>
+
+#include "bytecode/LocalVariableTable.h"
+#include "bytecode/Method.h"
+#include "bytecode/Symbols.h"
+
+/**
+ * Everything the agent reads from JVMTI about a method, fetched once per method.
+ * The names are owned by the record and freed with it, interning them would keep the names of every hidden, lambda and
+ * proxy class that ever threw an NPE. Only the descriptor is interned in Symbols.
+ */
+struct MethodInfo {
+  // Class name as returned by Class.getName
+  const std::string className;
+  const std::string methodName;
+  // Declaring class in internal form, e.g. java/lang/String
+  const std::string internalClassName;
+  // Refers to the names above
+  const Method method;
+  // Parameter slots including this, 0 for native methods
+  uint8_t argumentsSize;
+  // Empty for native methods and classes compiled without -g
+  LocalVariableTable localVariables;
+  // Hash of the bytecode when the record was fetched, 0 for native methods
+  uint64_t codeHash;
+
+  MethodInfo(std::string className, std::string internalClassName, std::string methodName, std::string_view signature,
+             uint32_t modifiers, uint8_t argumentsSize, LocalVariableTable localVariables, uint64_t codeHash) :
+      className(std::move(className)), methodName(std::move(methodName)),
+      internalClassName(std::move(internalClassName)),
+      method(this->className, this->methodName, Symbols::methodDescriptor(signature), modifiers),
+      argumentsSize(argumentsSize), localVariables(std::move(localVariables)), codeHash(codeHash) {}
+
+  MethodInfo(const MethodInfo &) = delete;
+
+  MethodInfo &operator=(const MethodInfo &) = delete;
+};
+
+/**
+ * Method records by jmethodID, so that a stack of frames costs one lookup per frame instead of a JVMTI call for each
+ * name, modifier and table. Records are immutable and evicted when their class is unloaded or redefined.
+ */
+class MethodCache {
+public:
+  /**
+   * Record of the method, fetched from JVMTI on first use
+   */
+  static std::shared_ptr<const MethodInfo> get(jmethodID method);
+
+  /**
+   * @return number of evicted records
+   */
+  static size_t evict(const std::unordered_set<jmethodID> &methods);
+
+  static size_t size();
+};
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * Blame tables kept in a cache directory across JVM restarts, shared by all JVMs on the host.
+ * Each JVM maps the segment files present when it starts. On shutdown it writes one new segment holding the tables
+ * it used or built, then the loaded ones that still fit the size limit, and deletes the segments it merged.
+ * Segments are renamed into place once complete, so concurrent JVMs never read a partial one.
+ */
+class PersistentBlameCache {
+public:
+  /**
+   * Map the segments in directory, creating it if needed. Logs and disables the cache if that fails
+   * @param sizeLimit maximum bytes of the segment written by save()
+   */
+  static void open(const std::string &directory, size_t sizeLimit);
+
+  /**
+   * Sites of a method persisted by an earlier JVM, empty if there is none or it was built from other code
+   * @param codeHash hash of everything the table depends on, e.g. code, constant pool and local variables
+   */
+  static std::optional<std::vector<std::pair<size_t, std::string>>> find(const std::string &key, uint64_t codeHash);
+
+  /**
+   * Keep a table built by this JVM for the next ones
+   */
+  static void record(std::string key, uint64_t codeHash, std::vector<std::pair<size_t, std::string>> sites);
+
+  /**
+   * Merge recorded tables and loaded segments into a new segment, nothing is written if no table was recorded
+   */
+  static void save();
+
+  /**
+   * Number of methods in the loaded segments
+   */
+  static size_t size();
+
+  static size_t getHits();
+};
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <unordered_set>
+#include <jvmti.h>
+
+#include "bytecode/StackAnalysis.h"
+
+/**
+ * Stack analyses of methods that threw an NPE the stack map could not explain. The method is analyzed once, later
+ * NPEs anywhere in it only replay their block from the cached entry stack.
+ */
+class StackFlowCache {
+public:
+  /**
+   * Get the flow of the method or analyze and cache it. Concurrent analyses of the same method may both run,
+   * the first one to finish is kept.
+   */
+  static std::shared_ptr<const StackAnalysis::Flow> get(
+      jmethodID method, const std::function<std::shared_ptr<const StackAnalysis::Flow>()> &analyze);
+
+  /**
+   * Remove the flows of the methods, e.g. of unloaded or redefined classes
+   * @return number of removed flows
+   */
+  static size_t evict(const std::unordered_set<jmethodID> &methods);
+
+  static size_t size();
+};
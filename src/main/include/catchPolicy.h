@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstddef>
+#include <jvmti.h>
+
+#include "options.h"
+
+/**
+ * Catch policy
+ *
+ * The exception event tells where an NPE will be caught. NPEs caught by a known swallower, e.g. a helper that turns
+ * them into an empty Optional, never have their message read and are not described. NPEs caught in the method that
+ * threw them are handled by the localCatch option.
+ *
+ * Swallowers are matched by name against the catching method, whose names are cached per method by MethodCache. Classes
+ * are never looked up, so naming a swallower neither loads nor initializes it and it may come from any class loader.
+ */
+class CatchPolicy {
+public:
+  /**
+   * @param catchMethod null if the NPE is not caught
+   */
+  static CatchAction evaluate(jmethodID method, jmethodID catchMethod);
+
+  /**
+   * Number of NPEs left without a message because of where they are caught
+   */
+  static size_t getSkipped();
+};
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <jni.h>
+#include <jvmti.h>
+
+/**
+ * ClassFileLoadHook of the agent, records class images if enabled and instruments NullPointerException in hook mode
+ */
+void JNICALL classFileLoadHook(jvmtiEnv *jvmti,
+                               JNIEnv *jni,
+                               jclass classBeingRedefined,
+                               jobject loader,
+                               const char *name,
+                               jobject protectionDomain,
+                               jint classDataLength,
+                               const unsigned char *classData,
+                               jint *newClassDataLength,
+                               unsigned char **newClassData);
@@ -2,9 +2,64 @@
 
 #include <vector>
 #include <cstdint>
+#include <optional>
+#include <string>
 #include <jni.h>
 #include <jvmti.h>
 
+#include "api/StackTrace.h"
+
+/**
+ * Local references reserved by each NPE callback, e.g. for declaring classes of looked up methods.
+ * Printing parameters pushes a frame per stack frame, see Jni::LocalFrame
+ */
+constexpr jint CALLBACK_LOCAL_REFS = 32;
+
+/**
+ * Marks the current thread as describing an NPE. Java code the agent runs meanwhile, e.g. a toString printing a
+ * parameter, may throw exceptions of its own. Callbacks check isActive() first and ignore those instead of recursing.
+ * With the threadEvents option, exception events are also turned off for the thread while the guard is alive.
+ */
+class AnalysisGuard {
+  jthread thread;
+  bool eventsDisabled = false;
+
+public:
+  static bool isActive();
+
+  /**
+   * @param thread null for the current thread, events are then left enabled
+   */
+  explicit AnalysisGuard(jthread thread);
+
+  ~AnalysisGuard();
+
+  AnalysisGuard(const AnalysisGuard &) = delete;
+
+  AnalysisGuard &operator=(const AnalysisGuard &) = delete;
+};
+
+/**
+ * Resolve the NPE class and Throwable.detailMessage used to filter exceptions in the callback.
+ * Safe to call multiple times, only the first successful call does any work.
+ */
+void initExceptionFilter(JNIEnv *jni);
+
+/**
+ * Description of what was null at location, empty if the instruction can't throw an NPE. Cached per site
+ */
+std::optional<std::string> describeNPE(jmethodID method, jlocation location);
+
+/**
+ * Describe what was null at location and store the description as the message of the NPE.
+ * Lazily, only the location is recorded, the description is built once the message is read
+ * @param stack stack of thread, only captured if frames other than method are needed
+ * @param depth stack depth of the frame executing method
+ * @param lazy only record the location, if lazy messages are installed
+ */
+void blameNPE(JNIEnv *jni, jthread thread, jobject exception, StackTrace &stack, jmethodID method, jlocation location,
+              uint32_t depth, bool lazy);
+
 void JNICALL exceptionCallback(jvmtiEnv *jvmti,
                                JNIEnv *jni,
                                jthread thread,
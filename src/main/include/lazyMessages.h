@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstddef>
+#include <jni.h>
+#include <jvmti.h>
+
+/**
+ * Lazy messages
+ *
+ * Most NPEs are caught without anyone reading their message. Instead of describing an NPE when it is thrown, only the
+ * frame to describe is recorded, in a table indexed by the JVMTI tag of the NPE. On JDK 14+ getMessage calls the
+ * native NullPointerException.getExtendedNPEMessage for NPEs without a message, it is bound to the agent and describes
+ * the recorded frame when the message is first read. NPEs without a record, e.g. thrown before VMInit or skipped by the
+ * catch policy, are passed on to the JVM's JVM_GetExtendedNPEMessage so they keep its helpful message.
+ *
+ * Record tags start at RECORD_TAG_BASE, far above the class handles of ClassRegistry.
+ */
+class LazyMessages {
+public:
+  static constexpr jlong RECORD_TAG_BASE = jlong(1) << 62;
+
+  /**
+   * Bind getExtendedNPEMessage to the agent, requires the live phase
+   * @return false before JDK 14, NPEs are then described when thrown
+   */
+  static bool install(jvmtiEnv *jvmti, JNIEnv *jni);
+
+  static bool isInstalled();
+
+  /**
+   * Remember the frame to describe once the message of exception is read. Rethrowing the NPE keeps the first frame
+   */
+  static void record(jobject exception, jmethodID method, jlocation location);
+
+  /**
+   * Release the record of a collected NPE, only touches agent memory so it can run in ObjectFree
+   * @return false if tag is not a record tag
+   */
+  static bool release(jlong tag);
+
+  static size_t getRecorded();
+
+  /**
+   * Number of messages read, i.e. of recorded NPEs that were described
+   */
+  static size_t getDescribed();
+};
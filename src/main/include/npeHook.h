@@ -0,0 +1,28 @@
+#pragma once
+
+#include <jni.h>
+#include <jvmti.h>
+
+/**
+ * Constructor hook mode
+ *
+ * Instead of enabling exception events for the whole VM, the no-arg constructor of java.lang.NullPointerException
+ * is retransformed to call a native method of the agent. The NPE analysis then only runs when an NPE is created,
+ * other exceptions don't pay anything.
+ */
+
+void JNICALL npeHookClassFileLoadHook(jvmtiEnv *jvmti,
+                                      JNIEnv *jni,
+                                      jclass classBeingRedefined,
+                                      jobject loader,
+                                      const char *name,
+                                      jobject protectionDomain,
+                                      jint classDataLength,
+                                      const unsigned char *classData,
+                                      jint *newClassDataLength,
+                                      unsigned char **newClassData);
+
+/**
+ * Define the callback class and retransform NullPointerException, requires the live phase
+ */
+void installNpeHook(jvmtiEnv *jvmti, JNIEnv *jni);
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <spdlog.h>
+
+enum class BlameMode {
+  // JVMTI exception event for every exception thrown in the VM
+  Event,
+  // Instrumented NullPointerException constructor calls back to the agent
+  Hook
+};
+
+enum class CatchAction {
+  // Describe the NPE when it is thrown
+  Describe,
+  // Record the throwing frame, describe the NPE when its message is read
+  Lazy,
+  // Leave the NPE without a message
+  Skip
+};
+
+/**
+ * Options passed to the agent, e.g. -agentpath:/path/to/libnpeblame.so=mode=hook,debug
+ */
+class AgentOptions {
+public:
+  spdlog::level::level_enum logLevel = spdlog::level::info;
+  BlameMode mode = BlameMode::Event;
+  // Maximum number of throw sites with a cached description
+  size_t cacheSize = 4096;
+  // Describe all NPE sites of a method on its first NPE, later NPEs in the method only look up their site
+  bool methodTables = false;
+  // Keep images of loaded classes, NPEs in them are analyzed without fetching the code from JVMTI
+  bool classImages = false;
+  // Maximum bytes of stored class images
+  size_t classImageMemory = 64 * 1024 * 1024;
+  // Index built by npeblame-indexer, methods in it are not analyzed at run time
+  std::string index;
+  // Directory where blame tables are kept across restarts, implies methodTables
+  std::string cacheDir;
+  // Maximum bytes of blame tables kept in cacheDir
+  size_t cacheDirSize = 16 * 1024 * 1024;
+  // Record only the throwing frame and describe it when the message is read, JDK 14+
+  bool lazyMessages = false;
+  // Methods, or all methods of classes, that catch NPEs and drop them, e.g. java.util.Optional;com.acme.Util.quietly
+  std::vector<std::string> swallowers;
+  // What to do with an NPE caught by a handler in the method that threw it
+  CatchAction localCatch = CatchAction::Describe;
+  // Enable exception events per thread, so that they can be turned off for a thread while it describes an NPE
+  bool threadEvents = false;
+
+  static AgentOptions parse(std::string_view options);
+
+  static void set(const AgentOptions &options);
+
+  static const AgentOptions &get();
+};
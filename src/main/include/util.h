@@ -8,6 +8,7 @@
 #include <jvmti.h>
 #include <spdlog.h>
 
+#include "bytecode/ByteView.h"
 #include "bytecode/ConstPool.h"
 #include "bytecode/CodeAttribute.h"
 
@@ -29,26 +30,26 @@ uint16_t opcodeSlot(uint8_t opCode);
 class ByteVectorUtil {
 public:
 
-  static uint8_t readuint8(const std::vector<uint8_t> &vec, size_t pos) {
+  static uint8_t readuint8(ByteView vec, size_t pos) {
     return vec[pos];
   }
 
-  static int8_t readint8(const std::vector<uint8_t> &vec, size_t pos) {
-    return reinterpret_cast<const int8_t &>(vec[pos]);
+  static int8_t readint8(ByteView vec, size_t pos) {
+    return static_cast<int8_t>(vec[pos]);
   }
 
-  static uint16_t readuint16(const std::vector<uint8_t> &vec, size_t pos) {
+  static uint16_t readuint16(ByteView vec, size_t pos) {
     uint16_t data = ((uint16_t) vec[pos] << 8) |
                     vec[pos + 1];
     return data;
   }
 
-  static int16_t readint16(const std::vector<uint8_t> &vec, size_t pos) {
+  static int16_t readint16(ByteView vec, size_t pos) {
     uint16_t data = ((uint16_t) vec[pos] << 8) | vec[pos + 1];
     return reinterpret_cast<const int16_t &>(data);
   }
 
-  static uint32_t readuint32(const std::vector<uint8_t> &vec, size_t pos) {
+  static uint32_t readuint32(ByteView vec, size_t pos) {
     uint32_t data = ((uint32_t) vec[pos] << 24) |
                     ((uint32_t) vec[pos + 1] << 16) |
                     ((uint32_t) vec[pos + 2] << 8) |
@@ -56,7 +57,7 @@ public:
     return data;
   }
 
-  static int32_t readint32(const std::vector<uint8_t> &vec, size_t pos) {
+  static int32_t readint32(ByteView vec, size_t pos) {
     uint32_t data = ((uint32_t) vec[pos] << 24) |
                     ((uint32_t) vec[pos + 1] << 16) |
                     ((uint32_t) vec[pos + 2] << 8) |
@@ -64,7 +65,7 @@ public:
     return reinterpret_cast<const int32_t &>(data);
   }
 
-  static uint64_t readuint64(const std::vector<uint8_t> &vec, size_t pos) {
+  static uint64_t readuint64(ByteView vec, size_t pos) {
     uint64_t data = ((uint64_t) vec[pos] << 56) |
                     ((uint64_t) vec[pos + 1] << 48) |
                     ((uint64_t) vec[pos + 2] << 40) |
@@ -76,7 +77,7 @@ public:
     return data;
   }
 
-  static int64_t readint64(const std::vector<uint8_t> &vec, size_t pos) {
+  static int64_t readint64(ByteView vec, size_t pos) {
     uint64_t data = ((uint64_t) vec[pos] << 56) |
                     ((uint64_t) vec[pos + 1] << 48) |
                     ((uint64_t) vec[pos + 2] << 40) |
@@ -88,7 +89,7 @@ public:
     return reinterpret_cast<const int64_t &>(data);
   }
 
-  static float readfloat(const std::vector<uint8_t> &vec, size_t pos) {
+  static float readfloat(ByteView vec, size_t pos) {
     uint32_t data = ((uint32_t) vec[pos] << 24) |
                     ((uint32_t) vec[pos + 1] << 16) |
                     ((uint32_t) vec[pos + 2] << 8) |
@@ -99,7 +100,7 @@ public:
     return ret;
   }
 
-  static double readdouble(const std::vector<uint8_t> &vec, size_t pos) {
+  static double readdouble(ByteView vec, size_t pos) {
     uint64_t data = ((uint64_t) vec[pos] << 56) |
                     ((uint64_t) vec[pos + 1] << 48) |
                     ((uint64_t) vec[pos + 2] << 40) |
@@ -113,4 +114,36 @@ public:
     std::memcpy(&ret, &data, sizeof(double));
     return ret;
   }
+
+  /**
+   * FNV-1a of the bytes, cheap enough to detect changed code or duplicate content before comparing it.
+   * Pass a previous hash to continue it over more bytes
+   */
+  static uint64_t hash(ByteView vec, uint64_t hash = 14695981039346656037ULL) {
+    for (uint8_t byte : vec) {
+      hash = (hash ^ byte) * 1099511628211ULL;
+    }
+    return hash;
+  }
+
+  static void writeuint8(std::vector<uint8_t> &vec, uint8_t value) {
+    vec.push_back(value);
+  }
+
+  static void writeuint16(std::vector<uint8_t> &vec, uint16_t value) {
+    vec.push_back(static_cast<uint8_t>(value >> 8));
+    vec.push_back(static_cast<uint8_t>(value));
+  }
+
+  static void writeuint32(std::vector<uint8_t> &vec, uint32_t value) {
+    vec.push_back(static_cast<uint8_t>(value >> 24));
+    vec.push_back(static_cast<uint8_t>(value >> 16));
+    vec.push_back(static_cast<uint8_t>(value >> 8));
+    vec.push_back(static_cast<uint8_t>(value));
+  }
+
+  static void writeutf8(std::vector<uint8_t> &vec, std::string_view value) {
+    writeuint16(vec, static_cast<uint16_t>(value.size()));
+    vec.insert(vec.end(), value.begin(), value.end());
+  }
 };